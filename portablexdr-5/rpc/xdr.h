@@ -16,22 +16,22 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
  */
 
-/* xdr_int8_t, xdr_uint8_t, xdr_int16_t, xdr_uint16_t, xdr_int32_t,
- * xdr_uint32_t, xdr_int64_t and xdr_uint64_t functions:
- *
- * Copyright (c) 1998, 1999, 2000, 2004, 2005 Free Software Foundation, Inc.
- * This file is part of the GNU C Library.
- * Contributed by Thorsten Kukuk <kukuk@vt.uni-paderborn.de>, 1998.
- *
- * (Under the same license as above).
- */
-
 #ifndef PORTABLEXDR_XDR_H
 #define PORTABLEXDR_XDR_H
 
 #include <rpc/types.h>
 #include <rpc/xdr_internal.h>
 #include <stdarg.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#else
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,237 +70,270 @@ xdr_bool (XDR *xdrs, bool_t *p)
   }
 }
 
-/* XDR 64bit integers */
-bool_t
-xdr_int64_t (XDR *xdrs, int64_t *ip)
+/* Fixed-size integers.  These are implemented in the library (not
+ * inline) so that each has a single address which xdr_vector and
+ * xdr_array can recognise.
+ */
+extern bool_t xdr_int64_t (XDR *xdrs, int64_t *ip);
+extern bool_t xdr_uint64_t (XDR *xdrs, uint64_t *uip);
+extern bool_t xdr_int32_t (XDR *xdrs, int32_t *lp);
+extern bool_t xdr_uint32_t (XDR *xdrs, uint32_t *ulp);
+extern bool_t xdr_int16_t (XDR *xdrs, int16_t *ip);
+extern bool_t xdr_uint16_t (XDR *xdrs, uint16_t *uip);
+extern bool_t xdr_int8_t (XDR *xdrs, int8_t *ip);
+extern bool_t xdr_uint8_t (XDR *xdrs, uint8_t *uip);
+
+/* Floating point.  These assume that the host uses IEEE 754 single
+ * and double precision (as XDR does), so the bits are simply copied
+ * and byte swapped.  Arrays of them are converted in one go, like
+ * arrays of integers.
+ */
+extern bool_t xdr_float (XDR *xdrs, float *fp);
+extern bool_t xdr_double (XDR *xdrs, double *dp);
+
+/* Some very common aliases for the basic integer functions. */
+#define xdr_int xdr_int32_t
+#define xdr_u_int xdr_uint32_t
+#define xdr_long xdr_int32_t
+#define xdr_u_long xdr_uint32_t
+
+#define xdr_short xdr_int16_t
+#define xdr_u_short xdr_uint16_t
+
+  /* NB: In PortableXDR, char is ALWAYS treated as signed octet. */
+#define xdr_char xdr_int8_t
+#define xdr_u_char xdr_uint8_t
+
+#define xdr_hyper xdr_int64_t
+#define xdr_u_hyper xdr_uint64_t
+#define xdr_quad xdr_int64_t
+#define xdr_u_quad xdr_uint64_t
+#define xdr_quad_t xdr_int64_t
+#define xdr_u_quad_t xdr_uint64_t
+#define xdr_longlong_t xdr_int64_t
+#define xdr_u_longlong_t xdr_uint64_t
+
+/* Enumerations. */
+static inline bool_t
+xdr_enum (XDR *xdrs, enum_t *ep)
 {
-  int32_t t1, t2;
-
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      t1 = (int32_t) ((*ip) >> 32);
-      t2 = (int32_t) (*ip);
-      return (XDR_PUTINT32(xdrs, &t1) && XDR_PUTINT32(xdrs, &t2));
-    case XDR_DECODE:
-      if (!XDR_GETINT32(xdrs, &t1) || !XDR_GETINT32(xdrs, &t2))
-        return FALSE;
-      *ip = ((int64_t) t1) << 32;
-      *ip |= (uint32_t) t2;	/* Avoid sign extension.  */
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  return xdr_int32_t (xdrs, ep);
 }
 
-/* XDR 64bit unsigned integers */
-bool_t
-xdr_uint64_t (XDR *xdrs, uint64_t *uip)
+/* Direction-specific conversions of the basic types.  The functions
+ * above test x_op on every call, whereas these are for code which
+ * knows which way it is going (such as the xdr_NAME_encode and
+ * xdr_NAME_decode functions made by rpcgen -e), and go straight to
+ * the cursor or to the stream's operation.  xdr_encode_* must only
+ * be used while x_op is XDR_ENCODE, and xdr_decode_* while it is
+ * XDR_DECODE.  The narrow integer types are encoded with
+ * xdr_encode_int32 or xdr_encode_uint32.
+ */
+static inline bool_t
+xdr_encode_int32 (XDR *xdrs, int32_t v)
 {
-  uint32_t t1;
-  uint32_t t2;
-
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      t1 = (uint32_t) ((*uip) >> 32);
-      t2 = (uint32_t) (*uip);
-      return (XDR_PUTINT32 (xdrs, (int32_t *) &t1) &&
-	      XDR_PUTINT32(xdrs, (int32_t *) &t2));
-    case XDR_DECODE:
-      if (!XDR_GETINT32(xdrs, (int32_t *) &t1) ||
-	  !XDR_GETINT32(xdrs, (int32_t *) &t2))
-        return FALSE;
-      *uip = ((uint64_t) t1) << 32;
-      *uip |= t2;
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  if (xdrmem_putlong (xdrs, &v))
+    return TRUE;
+  return xdrs->x_ops->x_putlong (xdrs, &v);
 }
-
-/* XDR 32bit integers */
-bool_t
-xdr_int32_t (XDR *xdrs, int32_t *lp)
+static inline bool_t
+xdr_decode_int32 (XDR *xdrs, int32_t *v)
 {
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      return XDR_PUTINT32 (xdrs, lp);
-    case XDR_DECODE:
-      return XDR_GETINT32 (xdrs, lp);
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  if (xdrmem_getlong (xdrs, v))
+    return TRUE;
+  return xdrs->x_ops->x_getlong (xdrs, v);
 }
-
-/* XDR 32bit unsigned integers */
-bool_t
-xdr_uint32_t (XDR *xdrs, uint32_t *ulp)
+static inline bool_t
+xdr_encode_uint32 (XDR *xdrs, uint32_t v)
+{
+  return xdr_encode_int32 (xdrs, (int32_t) v);
+}
+static inline bool_t
+xdr_decode_uint32 (XDR *xdrs, uint32_t *v)
 {
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      return XDR_PUTINT32 (xdrs, (int32_t *) ulp);
-    case XDR_DECODE:
-      return XDR_GETINT32 (xdrs, (int32_t *) ulp);
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  return xdr_decode_int32 (xdrs, (int32_t *) v);
 }
 
-/* XDR 16bit integers */
-bool_t
-xdr_int16_t (XDR *xdrs, int16_t *ip)
+static inline bool_t
+xdr_decode_int16 (XDR *xdrs, int16_t *v)
 {
   int32_t t;
 
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      t = (int32_t) *ip;
-      return XDR_PUTINT32 (xdrs, &t);
-    case XDR_DECODE:
-      if (!XDR_GETINT32 (xdrs, &t))
-	return FALSE;
-      *ip = (int16_t) t;
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  *v = (int16_t) t;
+  return TRUE;
 }
-
-/* XDR 16bit unsigned integers */
-bool_t
-xdr_uint16_t (XDR *xdrs, uint16_t *uip)
+static inline bool_t
+xdr_decode_uint16 (XDR *xdrs, uint16_t *v)
 {
-  uint32_t ut;
-
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      ut = (uint32_t) *uip;
-      return XDR_PUTINT32 (xdrs, (int32_t *) &ut);
-    case XDR_DECODE:
-      if (!XDR_GETINT32 (xdrs, (int32_t *) &ut))
-	return FALSE;
-      *uip = (uint16_t) ut;
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  int32_t t;
+
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  *v = (uint16_t) t;
+  return TRUE;
 }
+static inline bool_t
+xdr_decode_int8 (XDR *xdrs, int8_t *v)
+{
+  int32_t t;
 
-/* XDR 8bit integers */
-bool_t
-xdr_int8_t (XDR *xdrs, int8_t *ip)
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  *v = (int8_t) t;
+  return TRUE;
+}
+static inline bool_t
+xdr_decode_uint8 (XDR *xdrs, uint8_t *v)
 {
   int32_t t;
 
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      t = (int32_t) *ip;
-      return XDR_PUTINT32 (xdrs, &t);
-    case XDR_DECODE:
-      if (!XDR_GETINT32 (xdrs, &t))
-	return FALSE;
-      *ip = (int8_t) t;
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  *v = (uint8_t) t;
+  return TRUE;
 }
 
-/* XDR 8bit unsigned integers */
-bool_t
-xdr_uint8_t (XDR *xdrs, uint8_t *uip)
+/* Off the cursor, a hyper is moved as two units, either of which
+ * may cause the stream to refill or drain it.
+ */
+static inline bool_t
+xdr_encode_int64 (XDR *xdrs, int64_t v)
 {
-  uint32_t ut;
-
-  switch (xdrs->x_op)
-    {
-    case XDR_ENCODE:
-      ut = (uint32_t) *uip;
-      return XDR_PUTINT32 (xdrs, (int32_t *) &ut);
-    case XDR_DECODE:
-      if (!XDR_GETINT32 (xdrs, (int32_t *) &ut))
-	return FALSE;
-      *uip = (uint8_t) ut;
-      return TRUE;
-    case XDR_FREE:
-      return TRUE;
-    default:
-      return FALSE;
-    }
+  if (xdrmem_puthyper (xdrs, &v))
+    return TRUE;
+  return xdr_encode_int32 (xdrs, (int32_t) ((uint64_t) v >> 32)) &&
+    xdr_encode_int32 (xdrs, (int32_t) v);
 }
+static inline bool_t
+xdr_decode_int64 (XDR *xdrs, int64_t *v)
+{
+  int32_t t[2];
 
-#if 0
+  if (xdrmem_gethyper (xdrs, v))
+    return TRUE;
+  if (!xdr_decode_int32 (xdrs, &t[0]) || !xdr_decode_int32 (xdrs, &t[1]))
+    return FALSE;
+  *v = (int64_t) (((uint64_t) (uint32_t) t[0] << 32) | (uint32_t) t[1]);
+  return TRUE;
+}
+static inline bool_t
+xdr_encode_uint64 (XDR *xdrs, uint64_t v)
+{
+  return xdr_encode_int64 (xdrs, (int64_t) v);
+}
 static inline bool_t
-xdr_float (XDR *xdrs, float *p)
+xdr_decode_uint64 (XDR *xdrs, uint64_t *v)
 {
-  XXX;
+  return xdr_decode_int64 (xdrs, (int64_t *) v);
 }
 
 static inline bool_t
-xdr_double (XDR *xdrs, double *p)
+xdr_encode_bool (XDR *xdrs, bool_t v)
 {
-  XXX;
+  return xdr_encode_int32 (xdrs, v ? TRUE : FALSE);
 }
-#endif
+static inline bool_t
+xdr_decode_bool (XDR *xdrs, bool_t *v)
+{
+  int32_t t;
 
-/* Some very common aliases for the basic integer functions. */
-#define xdr_int xdr_int32_t
-#define xdr_u_int xdr_uint32_t
-#define xdr_long xdr_int32_t
-#define xdr_u_long xdr_uint32_t
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  *v = t ? TRUE : FALSE;
+  return TRUE;
+}
 
-#define xdr_short xdr_int16_t
-#define xdr_u_short xdr_uint16_t
+static inline bool_t
+xdr_encode_enum (XDR *xdrs, enum_t v)
+{
+  return xdr_encode_int32 (xdrs, v);
+}
+static inline bool_t
+xdr_decode_enum (XDR *xdrs, enum_t *v)
+{
+  return xdr_decode_int32 (xdrs, v);
+}
 
-  /* NB: In PortableXDR, char is ALWAYS treated as signed octet. */
-#define xdr_char xdr_int8_t
-#define xdr_u_char xdr_uint8_t
+/* See xdr_float and xdr_double. */
+static inline bool_t
+xdr_encode_float (XDR *xdrs, float v)
+{
+  int32_t t;
 
-/*
-#define xdr_hyper xdr_int64_t
-#define xdr_u_hyper xdr_uint64_t
-#define xdr_quad xdr_int64_t
-#define xdr_u_quad xdr_uint64_t
-*/
+  memcpy (&t, &v, sizeof t);
+  return xdr_encode_int32 (xdrs, t);
+}
+static inline bool_t
+xdr_decode_float (XDR *xdrs, float *v)
+{
+  int32_t t;
 
-/* Enumerations. */
+  if (!xdr_decode_int32 (xdrs, &t))
+    return FALSE;
+  memcpy (v, &t, sizeof t);
+  return TRUE;
+}
 static inline bool_t
-xdr_enum (XDR *xdrs, enum_t *ep)
+xdr_encode_double (XDR *xdrs, double v)
 {
-  return xdr_int32_t (xdrs, ep);
+  int64_t t;
+
+  memcpy (&t, &v, sizeof t);
+  return xdr_encode_int64 (xdrs, t);
+}
+static inline bool_t
+xdr_decode_double (XDR *xdrs, double *v)
+{
+  int64_t t;
+
+  if (!xdr_decode_int64 (xdrs, &t))
+    return FALSE;
+  memcpy (v, &t, sizeof t);
+  return TRUE;
 }
 
-/* Union with discriminator. */
+/* Union with discriminator.  The choices array is terminated by an
+ * entry with proc == NULL_xdrproc_t.
+ */
+struct xdr_discrim {
+  int value;
+  xdrproc_t proc;
+};
+
 extern bool_t xdr_union (XDR *xdrs, enum_t *discrim, void *p, struct xdr_discrim *choices, xdrproc_t default_proc);
 
-/* Variable-size array of arbitrary elements. */
-extern bool_t xdr_array (XDR *xdrs, void *p, size_t num_elements, size_t max_elements, size_t element_size, xdrproc_t element_proc);
+/* Variable-size array of arbitrary elements.
+ *
+ * For both kinds of array, if element_proc is one of the 32 or 64
+ * bit integer functions then the whole array is converted at once
+ * using vectorized code, instead of calling element_proc for each
+ * element.
+ */
+extern bool_t xdr_array (XDR *xdrs, char **p, uint32_t *num_elements, size_t max_elements, size_t element_size, xdrproc_t element_proc);
 
 /* Fixed-size array of arbitrary elements. */
-extern bool_t xdr_vector (XDR *xdrs, void *p, size_t num_elements, size_t element_size, xdrproc_t element_size);
+extern bool_t xdr_vector (XDR *xdrs, void *p, size_t num_elements, size_t element_size, xdrproc_t element_proc);
+
+/* Fixed-size arrays of the basic types, converted in one go.  These
+ * do the same as xdr_vector with the element function for the type,
+ * but without passing a function pointer which has to be recognised.
+ * rpcgen uses them for fixed-size arrays of the basic types.
+ */
+extern bool_t xdr_vector_int32 (XDR *xdrs, int32_t *p, size_t num_elements);
+extern bool_t xdr_vector_uint32 (XDR *xdrs, uint32_t *p, size_t num_elements);
+extern bool_t xdr_vector_int64 (XDR *xdrs, int64_t *p, size_t num_elements);
+extern bool_t xdr_vector_uint64 (XDR *xdrs, uint64_t *p, size_t num_elements);
+extern bool_t xdr_vector_float (XDR *xdrs, float *p, size_t num_elements);
+extern bool_t xdr_vector_double (XDR *xdrs, double *p, size_t num_elements);
+extern bool_t xdr_vector_int16 (XDR *xdrs, int16_t *p, size_t num_elements);
+extern bool_t xdr_vector_uint16 (XDR *xdrs, uint16_t *p, size_t num_elements);
+extern bool_t xdr_vector_int8 (XDR *xdrs, int8_t *p, size_t num_elements);
+extern bool_t xdr_vector_uint8 (XDR *xdrs, uint8_t *p, size_t num_elements);
 
 /* Variable-size array of bytes. */
-extern bool_t xdr_bytes (XDR *xdrs, char **bytes, size_t num_bytes, size_t max_bytes);
+extern bool_t xdr_bytes (XDR *xdrs, char **bytes, uint32_t *num_bytes, size_t max_bytes);
 
 /* Fixed-size array of bytes. */
 extern bool_t xdr_opaque (XDR *xdrs, void *p, size_t num_bytes);
@@ -310,33 +343,159 @@ extern bool_t xdr_opaque (XDR *xdrs, void *p, size_t num_bytes);
  */
 extern bool_t xdr_string (XDR *xdrs, char **str, size_t max_bytes);
 
-#define xdr_wrapstring(xdrs,str) (xdr_string ((xdrs),(str),~0))
+/* Unbounded string.  This is a function rather than a macro so that
+ * it can be passed as an xdrproc_t, eg. to xdr_free.
+ */
+extern bool_t xdr_wrapstring (XDR *xdrs, char **str);
 
-#if 0
-/* A reference is a pointer which cannot be NULL. */
-static inline bool_t
-xdr_reference (XDR *xdrs, void **p, size_t size, xdrproc_t proc)
-{
-  XXX
-}
+/* A reference is a pointer which cannot be NULL.  When decoding,
+ * if *p is NULL the object is allocated (and zeroed) first.
+ */
+extern bool_t xdr_reference (XDR *xdrs, char **p, size_t size, xdrproc_t proc);
 
 /* A pointer is a pointer to an object that can be NULL.  It is
  * serialized as a boolean (TRUE = not null, FALSE = null), followed
  * by the object.
  */
-static inline bool_t
-xdr_pointer (XDR *xdrs, void **p, size_t size, xdrproc_t proc)
-{
-  XXX
-}
-#endif
+extern bool_t xdr_pointer (XDR *xdrs, char **p, size_t size, xdrproc_t proc);
 
 /* Free an XDR object (recursively). */
 extern void xdr_free (xdrproc_t, void *);
 
-/* Construct an XDR stream from an in-memory buffer. */
+/* Check that buf (of len bytes) is exactly one well-formed
+ * encoding of the type handled by proc, without allocating memory
+ * for it.  Lengths are checked against their bounds and against the
+ * bytes which remain, so a huge length can't cause a huge
+ * allocation, and padding must be zero.  Union discriminants are
+ * checked by the union's function (rpcgen-generated code and
+ * xdr_union reject unknown values unless there is a default arm).
+ *
+ * The one exception is the elements of arrays and the objects
+ * behind pointers: these are checked in a 256 byte scratch area, and
+ * a type larger than that is given a temporary malloc'd buffer for
+ * each array or pointer.  Its size comes from the type, never from
+ * the input.
+ *
+ * obj must point to an object of the type, used as scratch space.
+ * Its contents afterwards are undefined, but it never owns memory,
+ * so it must not be passed to xdr_free.
+ */
+extern bool_t xdr_validate (xdrproc_t proc, void *obj, const void *buf, size_t len);
+
+/* Flags which change how a stream decodes, set with xdr_setflags.
+ *
+ * XDR_DECODE_BORROW: when xdr_bytes or xdr_string would allocate
+ * memory for the data, point into the input instead, so the object
+ * is only valid as long as the input buffer.  This is done only on
+ * streams made by xdrmem_create, xdrmmap_create and xdrfrag_create,
+ * and only when the data is contiguous in the input.  A string is
+ * borrowed only if it can be NUL-terminated in place, by writing
+ * into the padding after it, so input buffers may be modified.
+ * Other fields are still allocated as usual (or from the arena).
+ * Release such an object with xdr_free_borrowed, passing the input
+ * buffer(s), which frees everything except the borrowed fields.
+ */
+#define XDR_DECODE_BORROW 0x1
+
+/* XDR_DECODE_REUSE: when decoding into an object left by an earlier
+ * decode in the same mode (or zeroed), treat the buffers it points
+ * to as reusable, instead of allocating new ones.  Each buffer is
+ * grown with realloc only if the new data doesn't fit, and array
+ * elements which are no longer needed are freed, so decoding the
+ * same type in a loop reaches a steady state with no allocations,
+ * and xdr_free is only needed at the end.  This has no effect on
+ * streams with an arena, or when XDR_DECODE_BORROW is in effect.
+ */
+#define XDR_DECODE_REUSE 0x2
+
+extern void xdr_setflags (XDR *xdrs, unsigned int flags);
+extern unsigned int xdr_getflags (XDR *xdrs);
+extern void xdr_free_borrowed (xdrproc_t, void *, const struct iovec *iov, int iovcnt);
+
+/* Arenas for decoded data.
+ *
+ * Normally each variable-length field decoded by xdr_bytes,
+ * xdr_string, xdr_array, xdr_reference and xdr_pointer is allocated
+ * with malloc, and the whole object must be released with xdr_free.
+ * If an arena is attached to a decode stream with xdr_setarena,
+ * those allocations come from the arena instead.  Do not call
+ * xdr_free on such an object: xdr_arena_reset releases everything
+ * allocated since the last reset at once, and keeps the arena's
+ * memory for the next message.
+ *
+ * chunk_size is the size of the blocks the arena gets from malloc
+ * (pass 0 for a default size).  An arena may be shared by several
+ * streams, but is not thread safe.
+ */
+extern struct xdr_arena *xdr_arena_create (size_t chunk_size);
+extern void *xdr_arena_alloc (struct xdr_arena *arena, size_t size);
+extern void xdr_arena_reset (struct xdr_arena *arena);
+extern void xdr_arena_destroy (struct xdr_arena *arena);
+extern void xdr_setarena (XDR *xdrs, struct xdr_arena *arena);
+
+/* Return the number of bytes that proc would produce when encoding
+ * the object, without encoding it, or 0 if encoding would fail.
+ */
+extern unsigned long xdr_sizeof (xdrproc_t, void *);
+
+/* Construct an XDR stream from an in-memory buffer.  The stream
+ * does not copy the buffer, and xdr_inline returns pointers directly
+ * into it whenever enough bytes remain.
+ */
 extern void xdrmem_create (XDR *xdrs, void *p, size_t size, enum xdr_op);
 
+/* The reset functions below rebind an existing stream to a new
+ * message without destroying it, so that a handle can be kept per
+ * thread and reused.  Any buffers the stream owns are kept, as are
+ * the flags set with xdr_setflags and the arena set with
+ * xdr_setarena.  Each may only be called on a stream made by the
+ * matching create function.
+ *
+ * xdrmem_reset points a memory stream at a new buffer, and may also
+ * switch it between encoding and decoding.  It never allocates.
+ */
+extern void xdrmem_reset (XDR *xdrs, void *p, size_t size, enum xdr_op);
+
+/* Construct a growable encode stream.  Encoded data is stored in a
+ * linked list of chunk_size byte chunks (pass 0 for a default size),
+ * so the stream never has to be resized or the message re-encoded.
+ *
+ * After encoding, xdrchunk_getiov returns the data as an array of
+ * buffers suitable for writev (the return value is the number of
+ * buffers, or -1 on error), and xdrchunk_linearize returns it as a
+ * single buffer, copying only if it spans more than one chunk.  In
+ * both cases the memory belongs to the stream and is valid until
+ * the next put or xdr_destroy.
+ */
+extern void xdrchunk_create (XDR *xdrs, size_t chunk_size);
+
+/* As above, but any xdr_putbytes of at least threshold bytes (in
+ * practice the payload of xdr_opaque, xdr_bytes or xdr_string) is
+ * not copied.  Instead the buffer list returned by xdrchunk_getiov
+ * refers directly to the caller's memory, which must therefore stay
+ * valid and unchanged until the data has been written out.
+ */
+extern void xdrchunk_create2 (XDR *xdrs, size_t chunk_size, size_t threshold);
+extern int xdrchunk_getiov (XDR *xdrs, struct iovec **iovp);
+extern void *xdrchunk_linearize (XDR *xdrs, size_t *lenp);
+
+/* Discard everything encoded so far and start a new message at
+ * offset 0, keeping the chunks already allocated.  Buffers returned
+ * by xdrchunk_getiov and xdrchunk_linearize become invalid.
+ */
+extern void xdrchunk_reset (XDR *xdrs);
+
+/* Construct a decode stream over input which is split across
+ * several buffers, without first copying it into one.  The iov array
+ * and the buffers it points to must remain valid until xdr_destroy.
+ * Values may straddle buffer boundaries, but xdr_inline only
+ * succeeds when the requested bytes lie within a single buffer.
+ */
+extern void xdrfrag_create (XDR *xdrs, const struct iovec *iov, int iovcnt);
+
+/* Start decoding a new fragmented input, keeping the stream. */
+extern void xdrfrag_reset (XDR *xdrs, const struct iovec *iov, int iovcnt);
+
 /* Construct an XDR stream from a FILE* or file descriptor.  Note
  * that neither of these will close the underlying file.
  */
@@ -351,13 +510,141 @@ extern void xdrfd_create (XDR *xdrs, int fd, enum xdr_op);
 extern void xdrstdio_create2 (XDR *xdrs, FILE *, enum xdr_op, uint32_t flags);
 extern void xdrfd_create2 (XDR *xdrs, int fd, enum xdr_op, uint32_t flags);
 
-/*
-  Does anyone ever use these?  Contributions welcome.
-extern void xdrrec_create (...);
-extern bool_t xdrrec_endofrecord (...);
-extern bool_t xdrrec_skiprecord (...);
-extern bool_t xdrrec_eof (...);
-*/
+/* File descriptor streams are buffered.  xdrfd_create3 lets you
+ * choose the buffer size (0 means the default of 64 KiB).  Large
+ * buffers greatly reduce the number of system calls when streaming
+ * lots of data.
+ *
+ * When encoding, data is only written when the buffer fills, when
+ * you call xdrfd_flush, or on xdr_destroy.  xdrfd_buffered returns
+ * the number of bytes waiting to be written (when encoding) or read
+ * from the file but not yet decoded (when decoding).
+ */
+extern void xdrfd_create3 (XDR *xdrs, int fd, enum xdr_op, uint32_t flags, size_t bufsize);
+extern bool_t xdrfd_flush (XDR *xdrs);
+extern size_t xdrfd_buffered (XDR *xdrs);
+
+/* Rebind a file descriptor stream to fd (which may be the same one)
+ * and switch it to op, keeping the buffer.  Pending output is written
+ * out first, and xdr_getpos starts again from 0.  If the stream was
+ * created with XDR_CLOSE_FILE and fd is a different descriptor, the
+ * old one is closed.  When the same fd is kept after decoding, data
+ * which was read ahead but not decoded is lost unless fd is
+ * seekable.  Returns FALSE if the pending output couldn't be written
+ * (the stream is rebound regardless).
+ */
+extern bool_t xdrfd_reset (XDR *xdrs, int fd, enum xdr_op);
+
+/* Construct a decode stream which reads a whole file through a
+ * read-only memory mapping.  xdr_inline returns pointers into the
+ * mapping and xdr_setpos is a constant time operation.  The file
+ * offset of fd is ignored and unchanged.
+ *
+ * By default the kernel is told to expect sequential access.  Pass
+ * XDR_MMAP_RANDOM if you will be seeking around the file, and
+ * XDR_MMAP_WILLNEED to start reading it in immediately.
+ * XDR_CLOSE_FILE closes fd as soon as the file is mapped.
+ *
+ * Returns FALSE and sets errno on error (including on platforms
+ * without mmap), in which case the stream is empty but may still be
+ * destroyed.
+ */
+#define XDR_MMAP_RANDOM 2
+#define XDR_MMAP_WILLNEED 4
+
+extern bool_t xdrmmap_create (XDR *xdrs, int fd, uint32_t flags);
+
+/* Encode rings, which let many threads encode messages into one
+ * shared buffer without a lock, while a single consumer thread
+ * writes them out in order.
+ *
+ * xdr_ring_create allocates a ring of size bytes (rounded up to a
+ * power of 2, at most 1 GiB).  A producer calls xdrring_create to
+ * reserve space for a message of up to maxlen bytes (at most half
+ * the ring), encodes into the stream with the usual functions, then
+ * calls xdrring_publish.  Destroying the stream without publishing
+ * discards the message.  If the ring is full, xdrring_create waits
+ * for the consumer to make room.
+ *
+ * xdr_ring_drain writes every message published so far to fd,
+ * stopping at the first one still being encoded, and returns the
+ * number of bytes written, or -1 on error (in which case some
+ * messages may be written again by the next call).  Nothing but the
+ * encoded messages is written, so the output can be decoded as an
+ * ordinary XDR stream.  Only one thread may drain a ring at a time.
+ *
+ * Platforms without atomic operations fail with ENOSYS.
+ */
+struct xdr_ring;
+
+extern struct xdr_ring *xdr_ring_create (size_t size);
+extern void xdr_ring_destroy (struct xdr_ring *ring);
+extern ssize_t xdr_ring_drain (struct xdr_ring *ring, int fd);
+extern bool_t xdrring_create (XDR *xdrs, struct xdr_ring *ring, size_t maxlen);
+extern bool_t xdrring_publish (XDR *xdrs);
+
+/* Record indexes, for decoding files of many records in parallel.
+ *
+ * xdr_index_create makes a quick pass over the headers of the
+ * records in buf (for example a memory mapped file) and records
+ * where each one is.  framing is XDR_INDEX_RECORD_MARKING for record
+ * marking as written by xdrrec streams (RFC 5531), or
+ * XDR_INDEX_LENGTH_PREFIXED for records which are each a 4 byte
+ * length followed by the data, padded to a multiple of 4 bytes (the
+ * encoding of variable-length opaque data).  It returns NULL with
+ * errno set to EINVAL if the framing is invalid or the last record
+ * is incomplete.  buf must remain valid until the index is
+ * destroyed.
+ *
+ * xdr_index_count returns the number of records, and
+ * xdr_index_record creates a decode stream over record i, which
+ * must be destroyed after use.
+ *
+ * xdr_index_decode decodes every record with proc into a new object
+ * of size bytes, using nthreads threads including the caller, and
+ * passes each object to deliver.  deliver is never called by two
+ * threads at once, and is called in record order unless
+ * XDR_INDEX_UNORDERED is given, in which case records are delivered
+ * as soon as they are decoded.  The object then belongs to deliver,
+ * which should release it with xdr_free and free.  Decoding stops at
+ * the first record which fails to decode, or if deliver returns
+ * FALSE, and the function returns FALSE.  Without thread support,
+ * everything runs in the calling thread.
+ */
+#define XDR_INDEX_RECORD_MARKING 1
+#define XDR_INDEX_LENGTH_PREFIXED 2
+
+#define XDR_INDEX_UNORDERED 1
+
+struct xdr_index;
+
+extern struct xdr_index *xdr_index_create (const void *buf, size_t len, int framing);
+extern void xdr_index_destroy (struct xdr_index *index);
+extern size_t xdr_index_count (const struct xdr_index *index);
+extern bool_t xdr_index_record (const struct xdr_index *index, size_t i, XDR *xdrs);
+extern bool_t xdr_index_decode (const struct xdr_index *index, xdrproc_t proc, size_t size, int nthreads, unsigned int flags, bool_t (*deliver) (void *opaque, size_t i, void *obj), void *opaque);
+
+/* Record marking streams (RFC 5531), as used by every XDR protocol
+ * which runs over TCP.  readit and writeit are called with handle
+ * to move data to and from the underlying transport, and return the
+ * number of bytes transferred or -1 on error.
+ *
+ * sendsize and recvsize are the buffer sizes (0 means 64 KiB).
+ * xdrrec_create2 additionally sets the maximum fragment size; by
+ * default a fragment may fill the whole send buffer.  With a smaller
+ * fragment size, several fragments are batched into each write.
+ *
+ * xdrrec_endofrecord marks the end of the record being encoded, and
+ * writes out the buffer immediately if sendnow is TRUE.
+ * xdrrec_skiprecord discards the rest of the current input record
+ * (if any) and must be called before decoding each record.
+ * xdrrec_eof returns TRUE if there are no more input records.
+ */
+extern void xdrrec_create (XDR *xdrs, uint32_t sendsize, uint32_t recvsize, void *handle, int (*readit) (void *, void *, int), int (*writeit) (void *, void *, int));
+extern void xdrrec_create2 (XDR *xdrs, uint32_t sendsize, uint32_t recvsize, uint32_t fragsize, void *handle, int (*readit) (void *, void *, int), int (*writeit) (void *, void *, int));
+extern bool_t xdrrec_endofrecord (XDR *xdrs, bool_t sendnow);
+extern bool_t xdrrec_skiprecord (XDR *xdrs);
+extern bool_t xdrrec_eof (XDR *xdrs);
 
 #ifdef __cplusplus
 }
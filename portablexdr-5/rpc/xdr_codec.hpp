@@ -0,0 +1,371 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* C++ (C++17 or later) serializers for the headers made by rpcgen -x.
+ *
+ * A codec is a class with static functions
+ *
+ *   static bool encode (XDR *xdrs, const T &v);
+ *   static bool decode (XDR *xdrs, T &v);
+ *
+ * portable_xdr::codec<T> is specialised here for the basic types,
+ * and by rpcgen for each enum, struct and union.  Strings, opaque
+ * data, arrays and optional data have codecs which take the bound
+ * and the element codec as template arguments, because std::string
+ * and std::vector can't carry them.  Everything is inline, so the
+ * compiler sees the whole of a message at once.
+ *
+ * Like the xdr_encode_* and xdr_decode_* functions, encode must only
+ * be used while x_op is XDR_ENCODE, and decode while it is
+ * XDR_DECODE.  Decoding writes into the object directly, and on
+ * failure leaves it valid but partly decoded.
+ */
+
+#ifndef PORTABLEXDR_XDR_CODEC_HPP
+#define PORTABLEXDR_XDR_CODEC_HPP
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace portable_xdr {
+
+template <typename T> struct codec;
+
+/* Basic types.  The arithmetic types also have encode_n and decode_n
+ * for converting arrays in one call.
+ */
+#define PORTABLEXDR_CODEC(type, name)					\
+  template <> struct codec<type> {					\
+    static bool encode (XDR *xdrs, type v)				\
+    { return xdr_encode_##name (xdrs, v); }				\
+    static bool decode (XDR *xdrs, type &v)				\
+    { return xdr_decode_##name (xdrs, &v); }				\
+    static bool encode_n (XDR *xdrs, const type *p, size_t n)		\
+    { return xdr_vector_##name (xdrs, const_cast<type *> (p), n); }	\
+    static bool decode_n (XDR *xdrs, type *p, size_t n)		\
+    { return xdr_vector_##name (xdrs, p, n); }				\
+  }
+
+/* The narrow types are encoded as 32 bit integers. */
+#define PORTABLEXDR_CODEC_NARROW(type, name, wide)			\
+  template <> struct codec<type> {					\
+    static bool encode (XDR *xdrs, type v)				\
+    { return xdr_encode_##wide (xdrs, v); }				\
+    static bool decode (XDR *xdrs, type &v)				\
+    { return xdr_decode_##name (xdrs, &v); }				\
+    static bool encode_n (XDR *xdrs, const type *p, size_t n)		\
+    { return xdr_vector_##name (xdrs, const_cast<type *> (p), n); }	\
+    static bool decode_n (XDR *xdrs, type *p, size_t n)		\
+    { return xdr_vector_##name (xdrs, p, n); }				\
+  }
+
+PORTABLEXDR_CODEC (int32_t, int32);
+PORTABLEXDR_CODEC (uint32_t, uint32);
+PORTABLEXDR_CODEC (int64_t, int64);
+PORTABLEXDR_CODEC (uint64_t, uint64);
+PORTABLEXDR_CODEC (float, float);
+PORTABLEXDR_CODEC (double, double);
+PORTABLEXDR_CODEC_NARROW (int16_t, int16, int32);
+PORTABLEXDR_CODEC_NARROW (uint16_t, uint16, uint32);
+PORTABLEXDR_CODEC_NARROW (int8_t, int8, int32);
+PORTABLEXDR_CODEC_NARROW (uint8_t, uint8, uint32);
+
+#undef PORTABLEXDR_CODEC
+#undef PORTABLEXDR_CODEC_NARROW
+
+template <> struct codec<bool> {
+  static bool encode (XDR *xdrs, bool v)
+  {
+    return xdr_encode_bool (xdrs, v ? TRUE : FALSE);
+  }
+  static bool decode (XDR *xdrs, bool &v)
+  {
+    bool_t t;
+    if (!xdr_decode_bool (xdrs, &t))
+      return false;
+    v = t;
+    return true;
+  }
+};
+
+namespace detail {
+
+template <typename Codec, typename = void>
+struct has_bulk : std::false_type {};
+template <typename Codec>
+struct has_bulk<Codec, std::void_t<decltype (&Codec::decode_n)>>
+  : std::true_type {};
+
+/* Lengths come from the stream, so memory for them is only reserved
+ * up to what is left in the stream's buffer (every XDR value takes
+ * at least one unit), or min_reserve elements, and after that the
+ * container grows as the data arrives.
+ */
+const size_t min_reserve = 1024;
+
+inline size_t
+reserve_hint (XDR *xdrs, size_t n, size_t unit)
+{
+  size_t avail = (xdrs->x__end - xdrs->x__cur) / unit;
+  return std::min (n, std::max (avail, min_reserve));
+}
+
+template <typename Container>
+inline bool
+decode_bytes (XDR *xdrs, Container &v, uint32_t len)
+{
+  size_t rndup = RNDUP ((size_t) len), old, chunk;
+  char pad[BYTES_PER_XDR_UNIT];
+
+  if ((size_t) (xdrs->x__end - xdrs->x__cur) >= rndup) {
+    v.assign (xdrs->x__cur, xdrs->x__cur + len);
+    xdrs->x__cur += rndup;
+    return true;
+  }
+
+  v.clear ();
+  while (v.size () < len) {
+    old = v.size ();
+    chunk = reserve_hint (xdrs, len - old, 1);
+    v.resize (old + chunk);
+    if (!xdr_getbytes (xdrs, &v[old], chunk))
+      return false;
+  }
+  return rndup == len || xdr_getbytes (xdrs, pad, rndup - len);
+}
+
+} // namespace detail
+
+/* string<Max>, as std::string.  Anything which converts to
+ * std::string_view can be encoded.
+ */
+template <uint32_t Max = UINT32_MAX>
+struct string_codec {
+  static bool encode (XDR *xdrs, std::string_view v)
+  {
+    if (v.size () > Max)
+      return false;
+    return xdr_encode_uint32 (xdrs, (uint32_t) v.size ()) &&
+      xdr_opaque (xdrs, const_cast<char *> (v.data ()), v.size ());
+  }
+  static bool decode (XDR *xdrs, std::string &v)
+  {
+    uint32_t len;
+    if (!xdr_decode_uint32 (xdrs, &len) || len > Max)
+      return false;
+    return detail::decode_bytes (xdrs, v, len);
+  }
+};
+
+/* opaque<Max>, as std::vector<uint8_t>. */
+template <uint32_t Max = UINT32_MAX>
+struct opaque_codec {
+  static bool encode (XDR *xdrs, const std::vector<uint8_t> &v)
+  {
+    if (v.size () > Max)
+      return false;
+    return xdr_encode_uint32 (xdrs, (uint32_t) v.size ()) &&
+      xdr_opaque (xdrs, const_cast<uint8_t *> (v.data ()), v.size ());
+  }
+  static bool decode (XDR *xdrs, std::vector<uint8_t> &v)
+  {
+    uint32_t len;
+    if (!xdr_decode_uint32 (xdrs, &len) || len > Max)
+      return false;
+    return detail::decode_bytes (xdrs, v, len);
+  }
+};
+
+/* opaque[N], as std::array<uint8_t, N>. */
+struct fixed_opaque_codec {
+  template <size_t N>
+  static bool encode (XDR *xdrs, const std::array<uint8_t, N> &v)
+  {
+    return xdr_opaque (xdrs, const_cast<uint8_t *> (v.data ()), N);
+  }
+  template <size_t N>
+  static bool decode (XDR *xdrs, std::array<uint8_t, N> &v)
+  {
+    return xdr_opaque (xdrs, v.data (), N);
+  }
+};
+
+/* T[N], as std::array<T, N>. */
+template <typename Codec>
+struct array_codec {
+  template <typename T, size_t N>
+  static bool encode (XDR *xdrs, const std::array<T, N> &v)
+  {
+    if constexpr (detail::has_bulk<Codec>::value)
+      return Codec::encode_n (xdrs, v.data (), N);
+    else {
+      for (const T &e : v)
+	if (!Codec::encode (xdrs, e))
+	  return false;
+      return true;
+    }
+  }
+  template <typename T, size_t N>
+  static bool decode (XDR *xdrs, std::array<T, N> &v)
+  {
+    if constexpr (detail::has_bulk<Codec>::value)
+      return Codec::decode_n (xdrs, v.data (), N);
+    else {
+      for (T &e : v)
+	if (!Codec::decode (xdrs, e))
+	  return false;
+      return true;
+    }
+  }
+};
+
+/* T<Max>, as std::vector<T>.  Elements are decoded in place at the
+ * end of the vector.
+ */
+template <typename Codec, uint32_t Max = UINT32_MAX>
+struct vector_codec {
+  template <typename T>
+  static bool encode (XDR *xdrs, const std::vector<T> &v)
+  {
+    if (v.size () > Max || !xdr_encode_uint32 (xdrs, (uint32_t) v.size ()))
+      return false;
+    if constexpr (detail::has_bulk<Codec>::value)
+      return Codec::encode_n (xdrs, v.data (), v.size ());
+    else {
+      for (const T &e : v)
+	if (!Codec::encode (xdrs, e))
+	  return false;
+      return true;
+    }
+  }
+  template <typename T>
+  static bool decode (XDR *xdrs, std::vector<T> &v)
+  {
+    uint32_t n;
+    size_t old, chunk;
+
+    if (!xdr_decode_uint32 (xdrs, &n) || n > Max)
+      return false;
+    v.clear ();
+    if constexpr (detail::has_bulk<Codec>::value) {
+      while (v.size () < n) {
+	old = v.size ();
+	chunk = detail::reserve_hint (xdrs, n - old, BYTES_PER_XDR_UNIT);
+	v.resize (old + chunk);
+	if (!Codec::decode_n (xdrs, v.data () + old, chunk))
+	  return false;
+      }
+    }
+    else {
+      v.reserve (detail::reserve_hint (xdrs, n, BYTES_PER_XDR_UNIT));
+      for (uint32_t i = 0; i < n; ++i) {
+	if constexpr (std::is_same_v<T, bool>) {
+	  bool e;
+	  if (!Codec::decode (xdrs, e))
+	    return false;
+	  v.push_back (e);
+	}
+	else {
+	  v.emplace_back ();
+	  if (!Codec::decode (xdrs, v.back ()))
+	    return false;
+	}
+      }
+    }
+    return true;
+  }
+};
+
+/* T *, as std::optional<T>, or std::unique_ptr<T> for types which
+ * point to themselves (such as linked lists).
+ */
+template <typename Codec>
+struct optional_codec {
+  template <typename T>
+  static bool encode (XDR *xdrs, const std::optional<T> &v)
+  {
+    if (!xdr_encode_bool (xdrs, v.has_value () ? TRUE : FALSE))
+      return false;
+    return !v || Codec::encode (xdrs, *v);
+  }
+  template <typename T>
+  static bool decode (XDR *xdrs, std::optional<T> &v)
+  {
+    bool_t more;
+    if (!xdr_decode_bool (xdrs, &more))
+      return false;
+    if (!more) {
+      v.reset ();
+      return true;
+    }
+    if (!v)
+      v.emplace ();
+    return Codec::decode (xdrs, *v);
+  }
+  template <typename T>
+  static bool encode (XDR *xdrs, const std::unique_ptr<T> &v)
+  {
+    if (!xdr_encode_bool (xdrs, v ? TRUE : FALSE))
+      return false;
+    return !v || Codec::encode (xdrs, *v);
+  }
+  template <typename T>
+  static bool decode (XDR *xdrs, std::unique_ptr<T> &v)
+  {
+    bool_t more;
+    if (!xdr_decode_bool (xdrs, &more))
+      return false;
+    if (!more) {
+      v.reset ();
+      return true;
+    }
+    if (!v)
+      v = std::make_unique<T> ();
+    return Codec::decode (xdrs, *v);
+  }
+};
+
+/* Encode or decode a value of a type which has a codec. */
+template <typename T>
+inline bool
+encode (XDR *xdrs, const T &v)
+{
+  return codec<T>::encode (xdrs, v);
+}
+
+template <typename T>
+inline bool
+decode (XDR *xdrs, T &v)
+{
+  return codec<T>::decode (xdrs, v);
+}
+
+} // namespace portable_xdr
+
+#endif /* PORTABLEXDR_XDR_CODEC_HPP */
@@ -21,6 +21,9 @@
 
 #include <rpc/types.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +53,9 @@ enum xdr_op {
   XDR_FREE
 };
 
+typedef struct xdr XDR;
+struct xdr_arena;
+
 /* Operations available on an XDR data stream (file, socket or memory
  * area).  Callers shouldn't normally use these, but Sun's XDR
  * implementation exposes these operations, so we do too.
@@ -68,6 +74,12 @@ struct xdr_ops {
   void *    (*x_inline)   (XDR *, size_t);
   /* Free the stream. */
   void      (*x_destroy)  (XDR *);
+  /* Get/put n "longs".  These are optional: if a stream leaves them
+   * NULL, the library moves whole units through the cursor and uses
+   * x_getlong/x_putlong only to refill or drain it.
+   */
+  bool_t    (*x_getlongs) (XDR *, int32_t *, size_t);
+  bool_t    (*x_putlongs) (XDR *, int32_t *, size_t);
 };
 
 struct xdr {
@@ -79,35 +91,266 @@ struct xdr {
    */
   void *x_public;
 
-  struct xdr_ops x_ops;
+  const struct xdr_ops *x_ops;
 
   /* The remaining fields are private and could change in any
    * future release.  Calling code should not use or modify them.
    */
   void *x__private;
+
+  /* Flags describing how the stream should be handled.  Calling
+   * code changes these with xdr_setflags.  The top bits are private
+   * to the library and describe the stream itself.
+   */
+  unsigned int x__flags;
+
+  /* If not NULL, decoded data is allocated from this arena. */
+  struct xdr_arena *x__arena;
+
+  /* Streams backed by memory keep a cursor here, so that the
+   * common operations don't need to chase x__private.  Bytes
+   * between x__cur and x__end can be got or put directly.
+   */
+  char *x__base;
+  char *x__cur;
+  char *x__end;
 };
 
-/* Define wrapper functions around the x_ops. */
+/* Private flag for streams whose x_putbytes must see every payload,
+ * such as chunk streams which reference large payloads instead of
+ * copying them.  Fast paths which copy straight into the cursor
+ * are skipped for these streams.  It is defined in this header
+ * because the inline xdr_putbytes needs it.
+ */
+#define XDR__REFERENCE 0x04000000U
+
+#define BYTES_PER_XDR_UNIT 4
+
+/* Round up to a whole number of XDR units. */
+#define RNDUP(x) (((x) + BYTES_PER_XDR_UNIT - 1) & ~(BYTES_PER_XDR_UNIT - 1))
+
+/* Load and store a big-endian 32 bit quantity.  These are written
+ * so that they work at any alignment and on any host byte order,
+ * and GCC turns them into a single load or store plus bswap.
+ */
+static inline uint32_t
+xdr__load32 (const void *p)
+{
+  const unsigned char *b = (const unsigned char *) p;
+  return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) |
+    ((uint32_t) b[2] << 8) | (uint32_t) b[3];
+}
+static inline void
+xdr__store32 (void *p, uint32_t v)
+{
+  unsigned char *b = (unsigned char *) p;
+  b[0] = (unsigned char) (v >> 24);
+  b[1] = (unsigned char) (v >> 16);
+  b[2] = (unsigned char) (v >> 8);
+  b[3] = (unsigned char) v;
+}
+
+/* The same for a big-endian 64 bit quantity, which GCC turns into
+ * a single 8 byte load or store plus bswap.
+ */
+static inline uint64_t
+xdr__load64 (const void *p)
+{
+  const unsigned char *b = (const unsigned char *) p;
+  return ((uint64_t) b[0] << 56) | ((uint64_t) b[1] << 48) |
+    ((uint64_t) b[2] << 40) | ((uint64_t) b[3] << 32) |
+    ((uint64_t) b[4] << 24) | ((uint64_t) b[5] << 16) |
+    ((uint64_t) b[6] << 8) | (uint64_t) b[7];
+}
+static inline void
+xdr__store64 (void *p, uint64_t v)
+{
+  unsigned char *b = (unsigned char *) p;
+  b[0] = (unsigned char) (v >> 56);
+  b[1] = (unsigned char) (v >> 48);
+  b[2] = (unsigned char) (v >> 40);
+  b[3] = (unsigned char) (v >> 32);
+  b[4] = (unsigned char) (v >> 24);
+  b[5] = (unsigned char) (v >> 16);
+  b[6] = (unsigned char) (v >> 8);
+  b[7] = (unsigned char) v;
+}
+
+/* Bounded cursor operations.  Streams which keep their data in
+ * memory (such as those made by xdrmem_create and xdrmmap_create)
+ * are implemented entirely by these functions, so if you know that
+ * is the kind of stream you have, you can call them directly and the
+ * compiler can inline everything.  They return FALSE if there is not
+ * enough room between the cursor and the end of the buffer.
+ */
+static inline bool_t
+xdrmem_getlong (XDR *xdrs, int32_t *v)
+{
+  if (xdrs->x__end - xdrs->x__cur < BYTES_PER_XDR_UNIT)
+    return FALSE;
+  *v = (int32_t) xdr__load32 (xdrs->x__cur);
+  xdrs->x__cur += BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+static inline bool_t
+xdrmem_putlong (XDR *xdrs, int32_t *v)
+{
+  if (xdrs->x__end - xdrs->x__cur < BYTES_PER_XDR_UNIT)
+    return FALSE;
+  xdr__store32 (xdrs->x__cur, (uint32_t) *v);
+  xdrs->x__cur += BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+static inline bool_t
+xdrmem_gethyper (XDR *xdrs, int64_t *v)
+{
+  if (xdrs->x__end - xdrs->x__cur < 2 * BYTES_PER_XDR_UNIT)
+    return FALSE;
+  *v = (int64_t) xdr__load64 (xdrs->x__cur);
+  xdrs->x__cur += 2 * BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+static inline bool_t
+xdrmem_puthyper (XDR *xdrs, int64_t *v)
+{
+  if (xdrs->x__end - xdrs->x__cur < 2 * BYTES_PER_XDR_UNIT)
+    return FALSE;
+  xdr__store64 (xdrs->x__cur, (uint64_t) *v);
+  xdrs->x__cur += 2 * BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+static inline bool_t
+xdrmem_getbytes (XDR *xdrs, void *p, size_t len)
+{
+  if ((size_t) (xdrs->x__end - xdrs->x__cur) < len)
+    return FALSE;
+  memcpy (p, xdrs->x__cur, len);
+  xdrs->x__cur += len;
+  return TRUE;
+}
+static inline bool_t
+xdrmem_putbytes (XDR *xdrs, void *p, size_t len)
+{
+  if ((size_t) (xdrs->x__end - xdrs->x__cur) < len)
+    return FALSE;
+  memcpy (xdrs->x__cur, p, len);
+  xdrs->x__cur += len;
+  return TRUE;
+}
+static inline void *
+xdrmem_inline (XDR *xdrs, size_t len)
+{
+  char *p = xdrs->x__cur;
+
+  if ((size_t) (xdrs->x__end - p) < len)
+    return NULL;
+  xdrs->x__cur = p + len;
+  return p;
+}
+
+/* Define wrapper functions around the x_ops.  Most streams keep a
+ * cursor in the XDR handle for the direction they are working in, so
+ * the common operations are tried there first, and the indirect call
+ * is only made when the cursor runs out (or the stream has none).
+ */
 static inline bool_t
 xdr_getlong (XDR *xdrs, int32_t *v)
 {
+  if (xdrs->x_op != XDR_ENCODE && xdrmem_getlong (xdrs, v))
+    return TRUE;
   return xdrs->x_ops->x_getlong (xdrs, v);
 }
 static inline bool_t
 xdr_putlong (XDR *xdrs, int32_t *v)
 {
+  if (xdrs->x_op == XDR_ENCODE && xdrmem_putlong (xdrs, v))
+    return TRUE;
   return xdrs->x_ops->x_putlong (xdrs, v);
 }
 static inline bool_t
 xdr_getbytes (XDR *xdrs, void *p, size_t len)
 {
+  if (xdrs->x_op != XDR_ENCODE && xdrmem_getbytes (xdrs, p, len))
+    return TRUE;
   return xdrs->x_ops->x_getbytes (xdrs, p, len);
 }
 static inline bool_t
 xdr_putbytes (XDR *xdrs, void *p, size_t len)
 {
+  if (xdrs->x_op == XDR_ENCODE && !(xdrs->x__flags & XDR__REFERENCE) &&
+      xdrmem_putbytes (xdrs, p, len))
+    return TRUE;
   return xdrs->x_ops->x_putbytes (xdrs, p, len);
 }
+
+/* Get or put n "longs" in one operation, which costs at most one
+ * indirect call instead of one per unit.  xdr__getlongs and
+ * xdr__putlongs are the library's fallbacks for streams without
+ * x_getlongs/x_putlongs.
+ */
+extern bool_t xdr__getlongs (XDR *xdrs, int32_t *v, size_t n);
+extern bool_t xdr__putlongs (XDR *xdrs, int32_t *v, size_t n);
+
+static inline bool_t
+xdr_getlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  size_t i;
+
+  if (xdrs->x_op != XDR_ENCODE &&
+      (size_t) (xdrs->x__end - xdrs->x__cur) / BYTES_PER_XDR_UNIT >= n) {
+    for (i = 0; i < n; ++i)
+      v[i] = (int32_t) xdr__load32 (xdrs->x__cur + i * BYTES_PER_XDR_UNIT);
+    xdrs->x__cur += n * BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+  if (xdrs->x_ops->x_getlongs)
+    return xdrs->x_ops->x_getlongs (xdrs, v, n);
+  return xdr__getlongs (xdrs, v, n);
+}
+static inline bool_t
+xdr_putlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  size_t i;
+
+  if (xdrs->x_op == XDR_ENCODE &&
+      (size_t) (xdrs->x__end - xdrs->x__cur) / BYTES_PER_XDR_UNIT >= n) {
+    for (i = 0; i < n; ++i)
+      xdr__store32 (xdrs->x__cur + i * BYTES_PER_XDR_UNIT, (uint32_t) v[i]);
+    xdrs->x__cur += n * BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+  if (xdrs->x_ops->x_putlongs)
+    return xdrs->x_ops->x_putlongs (xdrs, v, n);
+  return xdr__putlongs (xdrs, v, n);
+}
+
+/* Get/put a 64 bit "hyper".  From the cursor this is a single load
+ * or store, otherwise both halves are moved with one x_getlongs or
+ * x_putlongs.
+ */
+static inline bool_t
+xdr_gethyper (XDR *xdrs, int64_t *v)
+{
+  int32_t t[2];
+
+  if (xdrs->x_op != XDR_ENCODE && xdrmem_gethyper (xdrs, v))
+    return TRUE;
+  if (!xdr_getlongs (xdrs, t, 2))
+    return FALSE;
+  *v = (int64_t) (((uint64_t) (uint32_t) t[0] << 32) | (uint32_t) t[1]);
+  return TRUE;
+}
+static inline bool_t
+xdr_puthyper (XDR *xdrs, int64_t *v)
+{
+  int32_t t[2];
+
+  if (xdrs->x_op == XDR_ENCODE && xdrmem_puthyper (xdrs, v))
+    return TRUE;
+  t[0] = (int32_t) ((uint64_t) *v >> 32);
+  t[1] = (int32_t) *v;
+  return xdr_putlongs (xdrs, t, 2);
+}
 static inline off_t
 xdr_getpos (XDR *xdrs)
 {
@@ -118,7 +361,7 @@ xdr_setpos (XDR *xdrs, off_t v)
 {
   return xdrs->x_ops->x_setpostn (xdrs, v);
 }
-static inline void 
+static inline void *
 xdr_inline (XDR *xdrs, size_t len)
 {
   return xdrs->x_ops->x_inline (xdrs, len);
@@ -149,7 +392,7 @@ xdr_destroy (XDR *xdrs)
  * optimize using these macros by doing:
  *
  *   if (xdr->x_op == XDR_DECODE) {
- *     void *buf = xdr_inline (xdr, 4 * BYTES_PER_XDR_UNIT);
+ *     int32_t *buf = xdr_inline (xdr, 4 * BYTES_PER_XDR_UNIT);
  *     if (buf) {
  *       i0 = IXDR_GET_LONG (buf); // NB. Macro autoincrements buf.
  *       i1 = IXDR_GET_LONG (buf);
@@ -171,28 +414,40 @@ xdr_destroy (XDR *xdrs)
  * Note that you have to fallback in the case when xdr_inline
  * returns NULL.  This is NOT an error case.
  *
- * Whether this optimization is really worth it or not is left as
- * an exercise in benchmarking.  In any case, PortableXDR's rpcgen
- * does NOT perform this optimization.
+ * PortableXDR's rpcgen generates code like this for runs of
+ * fixed-size struct fields (see its -i option).
  */
 
-#define BYTES_PER_XDR_UNIT 4
-
-#define IXDR_GET_LONG(buf) ((int32_t) ntohl (*((int32_t *)(buf))++))
+/* 'buf' must be an lvalue of type int32_t * (or uint32_t *), as
+ * returned by xdr_inline.
+ */
+#define IXDR_GET_INT32(buf) ((int32_t) xdr__load32 ((buf)++))
+#define IXDR_GET_U_INT32(buf) ((uint32_t) xdr__load32 ((buf)++))
+#define IXDR_GET_LONG IXDR_GET_INT32
 #define IXDR_GET_BOOL(buf) ((bool_t) IXDR_GET_LONG ((buf)))
 #define IXDR_GET_ENUM(buf,type) ((type) IXDR_GET_LONG ((buf)))
-#define IXDR_GET_U_LONG(buf) ((uint32_t) IXDR_GET_LONG ((buf)))
+#define IXDR_GET_U_LONG(buf) IXDR_GET_U_INT32 ((buf))
 #define IXDR_GET_SHORT(buf) ((int16_t) IXDR_GET_LONG ((buf)))
 #define IXDR_GET_U_SHORT(buf) ((uint16_t) IXDR_GET_LONG ((buf)))
-#define IXDR_GET_INT32 IXDR_GET_LONG
 
-#define IXDR_PUT_LONG(buf,v) ((*((int32_t *)(buf))++) = htonl ((v)))
+/* A hyper takes two units, so these advance buf by two. */
+#define IXDR_GET_HYPER(buf) \
+  ((int64_t) xdr__load64 (((buf) += 2) - 2))
+#define IXDR_GET_U_HYPER(buf) \
+  ((uint64_t) xdr__load64 (((buf) += 2) - 2))
+
+#define IXDR_PUT_INT32(buf,v) xdr__store32 ((buf)++, (uint32_t) (v))
+#define IXDR_PUT_U_INT32 IXDR_PUT_INT32
+#define IXDR_PUT_LONG IXDR_PUT_INT32
 #define IXDR_PUT_BOOL(buf,v) IXDR_PUT_LONG((buf), (int32_t) (v))
 #define IXDR_PUT_ENUM(buf,v) IXDR_PUT_LONG((buf), (int32_t) (v))
 #define IXDR_PUT_U_LONG(buf,v) IXDR_PUT_LONG((buf), (int32_t) (v))
 #define IXDR_PUT_SHORT(buf,v) IXDR_PUT_LONG((buf), (int32_t) (v))
 #define IXDR_PUT_U_SHORT(buf,v) IXDR_PUT_LONG((buf), (int32_t) (v))
-#define IXDR_PUT_INT32 IXDR_PUT_LONG
+
+#define IXDR_PUT_HYPER(buf,v) \
+  xdr__store64 (((buf) += 2) - 2, (uint64_t) (v))
+#define IXDR_PUT_U_HYPER IXDR_PUT_HYPER
 
 #ifdef __cplusplus
 }
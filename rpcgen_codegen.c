@@ -36,6 +36,23 @@ static void gen_line (void);
 static void gen_decl (int indent, const struct decl *);
 static void gen_decl_xdr_call (int indent, const struct decl *, const char *);
 static void gen_type (const struct type *);
+static void forget_sizes (void);
+static void remember_const (const char *name, const char *value);
+static void gen_enum_size (const char *name);
+static void gen_struct_size (const char *name, const struct cons *decls);
+static void gen_union_size (const char *name, const struct decl *discrim, const struct cons *union_cases);
+static void gen_typedef_size (const struct decl *decl);
+static void gen_enum_dir (const char *name);
+static void gen_struct_dir (const char *name, const struct cons *decls);
+static void gen_union_dir (const char *name, const struct decl *discrim, const struct cons *union_cases);
+static void gen_typedef_dir (const struct decl *decl);
+static void gen_cxx_prologue (void);
+static void gen_cxx_epilogue (void);
+static void gen_cxx_const (const char *name, const char *value);
+static void gen_cxx_enum (const char *name, const struct cons *enum_values);
+static void gen_cxx_struct (const char *name, const struct cons *decls);
+static void gen_cxx_union (const char *name, const struct decl *discrim, const struct cons *union_cases);
+static void gen_cxx_typedef (const struct decl *decl);
 
 static void
 spaces (int n)
@@ -61,9 +78,11 @@ gen_line (void)
 static void
 write_basename (void)
 {
-  const char *p = strrchr (output_filename, '/') ? : output_filename;
+  const char *p = strrchr (output_filename, '/');
   const char *q = strrchr (output_filename, '.');
 
+  p = p ? p + 1 : output_filename;
+
   while (*p && p != q) {
     fputc (*p, yyout);
     ++p;
@@ -73,9 +92,11 @@ write_basename (void)
 static void
 write_basename_caps (void)
 {
-  const char *p = strrchr (output_filename, '/') ? : output_filename;
+  const char *p = strrchr (output_filename, '/');
   const char *q = strrchr (output_filename, '.');
 
+  p = p ? p + 1 : output_filename;
+
   while (*p && p != q) {
     if (isalnum (*p))
       fputc (toupper (*p), yyout);
@@ -85,9 +106,213 @@ write_basename_caps (void)
   }
 }
 
+/* Types which are encoded as a fixed number of XDR units, so that
+ * struct fields of these types can be handled with the IXDR macros
+ * in an xdr_inline block (see gen_struct).  Besides the built-in
+ * integer types, these are the enums and the typedefs of such types
+ * seen so far in the input.  An enum is stored as type_ident with
+ * its own name, and a typedef as the type it resolves to.
+ */
+struct known_type {
+  struct known_type *next;
+  char *name;
+  struct type type;
+};
+
+static struct known_type *known_types = NULL;
+
+static void
+forget_types (void)
+{
+  struct known_type *k, *next;
+
+  for (k = known_types; k; k = next) {
+    next = k->next;
+    free (k->name);
+    free (k->type.ident);
+    free (k);
+  }
+  known_types = NULL;
+}
+
+static void
+remember_type (const char *name, const struct type *type)
+{
+  struct known_type *k = malloc (sizeof *k);
+
+  if (k == NULL)
+    perrorf ("malloc");
+  k->name = strdup (name);
+  k->type = *type;
+  k->type.ident = type->ident ? strdup (type->ident) : NULL;
+  if (k->name == NULL || (type->ident && k->type.ident == NULL))
+    perrorf ("strdup");
+  k->next = known_types;
+  known_types = k;
+}
+
+/* Return the number of XDR units a value of this type takes if it
+ * can be encoded inline, else 0.  *resolved is set to the type to
+ * use with gen_inline_get and gen_inline_put.
+ */
+static int
+inline_units (const struct type *type, const struct type **resolved)
+{
+  const struct known_type *k;
+
+  if (type->type == type_ident) {
+    for (k = known_types; k; k = k->next)
+      if (strcmp (k->name, type->ident) == 0) {
+	*resolved = &k->type;
+	return k->type.type == type_hyper ? 2 : 1;
+      }
+    return 0;
+  }
+
+  *resolved = type;
+  switch (type->type) {
+  case type_char: case type_short: case type_int: case type_bool:
+    return 1;
+  case type_hyper:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/* Print the expression which decodes a value from buf. */
+static void
+gen_inline_get (const struct type *type)
+{
+  switch (type->type) {
+  case type_char:
+    if (type->sgn) fputs ("(int8_t) IXDR_GET_INT32 (buf)", yyout);
+    else fputs ("(uint8_t) IXDR_GET_U_INT32 (buf)", yyout);
+    break;
+  case type_short:
+    if (type->sgn) fputs ("IXDR_GET_SHORT (buf)", yyout);
+    else fputs ("IXDR_GET_U_SHORT (buf)", yyout);
+    break;
+  case type_int:
+    if (type->sgn) fputs ("IXDR_GET_INT32 (buf)", yyout);
+    else fputs ("IXDR_GET_U_INT32 (buf)", yyout);
+    break;
+  case type_hyper:
+    if (type->sgn) fputs ("IXDR_GET_HYPER (buf)", yyout);
+    else fputs ("IXDR_GET_U_HYPER (buf)", yyout);
+    break;
+  case type_bool:
+    fputs ("IXDR_GET_BOOL (buf) ? TRUE : FALSE", yyout);
+    break;
+  case type_ident:
+    fprintf (yyout, "IXDR_GET_ENUM (buf, %s)", type->ident);
+    break;
+  default: abort ();		/* Avoid GCC warning. */
+  }
+}
+
+/* Print the statement which encodes prefix+ident into buf. */
+static void
+gen_inline_put (const struct type *type, const char *prefix, const char *ident)
+{
+  const char *r;
+
+  switch (type->type) {
+  case type_char:
+  case type_int:
+    if (type->sgn) r = "IXDR_PUT_INT32"; else r = "IXDR_PUT_U_INT32";
+    break;
+  case type_short:
+    if (type->sgn) r = "IXDR_PUT_SHORT"; else r = "IXDR_PUT_U_SHORT";
+    break;
+  case type_hyper:
+    if (type->sgn) r = "IXDR_PUT_HYPER"; else r = "IXDR_PUT_U_HYPER";
+    break;
+  case type_bool:
+    fprintf (yyout, "IXDR_PUT_BOOL (buf, %s%s ? TRUE : FALSE);\n",
+	     prefix, ident);
+    return;
+  case type_ident:
+    r = "IXDR_PUT_ENUM";
+    break;
+  default: abort ();		/* Avoid GCC warning. */
+  }
+  fprintf (yyout, "%s (buf, %s%s);\n", r, prefix, ident);
+}
+
+/* Count the fields at the start of decls which can be encoded
+ * inline, and the XDR units they take.
+ */
+static int
+inline_run (const struct cons *decls, int *units)
+{
+  const struct type *type;
+  const struct decl *decl;
+  int n = 0, u;
+
+  *units = 0;
+  for (; decls; decls = decls->next) {
+    decl = (const struct decl *) decls->ptr;
+    if (decl->decl_type != decl_type_simple)
+      break;
+    u = inline_units (decl->type, &type);
+    if (u == 0)
+      break;
+    *units += u;
+    n++;
+  }
+  return n;
+}
+
+/* Encode or decode n fields through a single xdr_inline buffer,
+ * falling back to the ordinary calls if the stream can't provide
+ * one.
+ */
+static void
+gen_inline_block (const struct cons *decls, int n, int units)
+{
+  const struct cons *d;
+  const struct decl *decl;
+  const struct type *type;
+  int i;
+
+  fprintf (yyout,
+	   "  if (xdrs->x_op == XDR_DECODE &&\n"
+	   "      (buf = (int32_t *) xdr_inline (xdrs, %d * BYTES_PER_XDR_UNIT)) != NULL) {\n",
+	   units);
+  for (d = decls, i = 0; i < n; d = d->next, ++i) {
+    decl = (const struct decl *) d->ptr;
+    inline_units (decl->type, &type);
+    fprintf (yyout, "    objp->%s = ", decl->ident);
+    gen_inline_get (type);
+    fputs (";\n", yyout);
+  }
+  fprintf (yyout,
+	   "  }\n"
+	   "  else if (xdrs->x_op == XDR_ENCODE &&\n"
+	   "           (buf = (int32_t *) xdr_inline (xdrs, %d * BYTES_PER_XDR_UNIT)) != NULL) {\n",
+	   units);
+  for (d = decls, i = 0; i < n; d = d->next, ++i) {
+    decl = (const struct decl *) d->ptr;
+    inline_units (decl->type, &type);
+    spaces (4);
+    gen_inline_put (type, "objp->", decl->ident);
+  }
+  fprintf (yyout,
+	   "  }\n"
+	   "  else {\n");
+  for (d = decls, i = 0; i < n; d = d->next, ++i)
+    gen_decl_xdr_call (4, (const struct decl *) d->ptr, "objp->");
+  fprintf (yyout,
+	   "  }\n");
+}
+
 void
 gen_prologue (const char *filename)
 {
+  forget_types ();
+  forget_sizes ();
+
   fprintf (yyout,
 	   "/* This file was generated by PortableXDR rpcgen %s\n"
 	   " * ANY CHANGES YOU MAKE TO THIS FILE MAY BE LOST!\n"
@@ -99,6 +324,7 @@ gen_prologue (const char *filename)
   switch (output_mode)
     {
     case output_c:
+      fprintf (yyout, "#include <string.h>\n");
       fprintf (yyout, "#include \"");
       write_basename ();
       fprintf (yyout, ".h\"\n\n");
@@ -131,6 +357,10 @@ gen_prologue (const char *filename)
 	       " 1\n"
 	       "\n");
       break;
+
+    case output_cxx:
+      gen_cxx_prologue ();
+      break;
     }
 }
 
@@ -155,6 +385,10 @@ gen_epilogue (void)
       write_basename_caps ();
       fprintf (yyout, "_H */\n");
       break;
+
+    case output_cxx:
+      gen_cxx_epilogue ();
+      break;
     }
 
   fprintf (yyout, "\n/* EOF */\n");
@@ -163,16 +397,25 @@ gen_epilogue (void)
 void
 gen_const (const char *name, const char *value)
 {
+  remember_const (name, value);
+
   if (output_mode == output_h) {
     gen_line ();
 
     fprintf (yyout, "#define %s %s\n", name, value);
   }
+  else if (output_mode == output_cxx) {
+    gen_line ();
+    gen_cxx_const (name, value);
+  }
 }
 
 void
 gen_enum (const char *name, const struct cons *enum_values)
 {
+  struct type type = { type_ident, 0, (char *) name };
+
+  remember_type (name, &type);
   gen_line ();
 
   switch (output_mode)
@@ -191,8 +434,7 @@ gen_enum (const char *name, const struct cons *enum_values)
       fprintf (yyout,
 	       "};\n"
 	       "typedef enum %s %s;\n"
-	       "extern bool_t xdr_%s (XDR *, %s *);\n"
-	       "\n",
+	       "extern bool_t xdr_%s (XDR *, %s *);\n",
 	       name, name, name, name);
       break;
 
@@ -208,33 +450,49 @@ gen_enum (const char *name, const struct cons *enum_values)
 	       "\n",
 	       name, name);
       break;
+
+    case output_cxx:
+      gen_cxx_enum (name, enum_values);
+      break;
     }
+
+  gen_enum_size (name);
+  gen_enum_dir (name);
 }
 
-/* The Sun rpcgen seems to do some sort of inlining optimization based
- * on {size of struct|number of elements}(?)  We don't do any such
- * optimization.  Instead we rely on gcc doing the correct level of
- * optimization based on inlined functions found in the header files.
+/* Like the Sun rpcgen, runs of at least inline_threshold fields
+ * which take a fixed number of XDR units are encoded and decoded
+ * through a single xdr_inline buffer with the IXDR macros, which
+ * replaces a call and a bounds check per field with one for the
+ * whole run.  Everything else is left to the xdr_* functions, and
+ * to gcc inlining them from the header files.
  */
 void
 gen_struct (const char *name, const struct cons *decls)
 {
+  const struct cons *fields = decls, *d;
+  int n, units, use_inline = 0;
+
   gen_line ();
 
   switch (output_mode)
     {
     case output_h:
-      fprintf (yyout, "struct %s {\n", name);
+      /* The typedef comes first so that fields can point to the
+       * struct itself, as in linked lists.
+       */
+      fprintf (yyout,
+	       "typedef struct %s %s;\n"
+	       "struct %s {\n",
+	       name, name, name);
       while (decls) {
 	gen_decl (2, (struct decl *) decls->ptr);
 	decls = decls->next;
       }
       fprintf (yyout,
 	       "};\n"
-	       "typedef struct %s %s;\n"
-	       "extern bool_t xdr_%s (XDR *, %s *);\n"
-	       "\n",
-	       name, name, name, name);
+	       "extern bool_t xdr_%s (XDR *, %s *);\n",
+	       name, name);
       break;
 
     case output_c:
@@ -243,31 +501,62 @@ gen_struct (const char *name, const struct cons *decls)
 	       "xdr_%s (XDR *xdrs, %s *objp)\n"
 	       "{\n",
 	       name, name);
+
+      if (inline_threshold > 0)
+	for (d = decls; d; d = d->next)
+	  if (inline_run (d, &units) >= inline_threshold)
+	    use_inline = 1;
+      if (use_inline)
+	fprintf (yyout, "  int32_t *buf;\n\n");
+
       while (decls) {
-	gen_decl_xdr_call (2, (struct decl *) decls->ptr, "&objp->");
-	decls = decls->next;
+	n = use_inline ? inline_run (decls, &units) : 0;
+	if (n >= inline_threshold && n > 0) {
+	  gen_inline_block (decls, n, units);
+	  while (n-- > 0)
+	    decls = decls->next;
+	}
+	else {
+	  gen_decl_xdr_call (2, (struct decl *) decls->ptr, "objp->");
+	  decls = decls->next;
+	}
       }
       fprintf (yyout,
 	       "  return TRUE;\n"
 	       "}\n"
 	       "\n");
       break;
+
+    case output_cxx:
+      gen_cxx_struct (name, fields);
+      break;
     }
+
+  gen_struct_size (name, fields);
+  gen_struct_dir (name, fields);
 }
 
 void
 gen_union (const char *name, const struct decl *discrim,
 	   const struct cons *union_cases)
 {
+  const struct cons *cases = union_cases;
   char *str;
   int len;
+  int has_default;
 
   gen_line ();
 
   switch (output_mode)
     {
     case output_h:
-      fprintf (yyout, "struct %s {\n", name);
+      /* As for structs, the typedef comes first so that arms can
+       * point to the union itself.
+       */
+      fprintf (yyout,
+	       "typedef struct %s %s;\n"
+	       "struct %s {\n",
+	       name, name, name);
       gen_decl (2, discrim);
       fprintf (yyout, "  union {\n");
 
@@ -279,10 +568,8 @@ gen_union (const char *name, const struct decl *discrim,
       fprintf (yyout,
 	       "  } %s_u;\n"
 	       "};\n"
-	       "typedef struct %s %s;\n"
-	       "extern bool_t xdr_%s (XDR *, %s *);\n"
-	       "\n",
-	       name, name, name, name, name);
+	       "extern bool_t xdr_%s (XDR *, %s *);\n",
+	       name, name, name);
       break;
 
     case output_c:
@@ -291,25 +578,39 @@ gen_union (const char *name, const struct decl *discrim,
 	       "xdr_%s (XDR *xdrs, %s *objp)\n"
 	       "{\n",
 	       name, name);
-      gen_decl_xdr_call (2, discrim, "&objp->");
+      gen_decl_xdr_call (2, discrim, "objp->");
       fprintf (yyout,
 	       "  switch (objp->%s) {\n",
 	       discrim->ident);
 
-      len = strlen (name) + 11;
+      len = strlen (name) + 10;
       str = malloc (len);
-      snprintf (str, len, "&objp->%s_u.", name);
+      snprintf (str, len, "objp->%s_u.", name);
 
+      has_default = 0;
       while (union_cases) {
 	struct union_case *uc = (struct union_case *) union_cases->ptr;
-	fprintf (yyout,
-		 "  case %s:\n",
-		 uc->const_);
-	gen_decl_xdr_call (4, uc->decl, str);
+	if (uc->type == union_case_normal)
+	  fprintf (yyout,
+		   "  case %s:\n",
+		   uc->const_);
+	else {
+	  fprintf (yyout, "  default:\n");
+	  has_default = 1;
+	}
+	if (uc->decl)
+	  gen_decl_xdr_call (4, uc->decl, str);
 	fprintf (yyout,
 		 "    break;\n");
 	union_cases = union_cases->next;
       }
+      /* A discriminant which matches no arm is an error (RFC 4506
+       * section 4.15), so untrusted input can't get through with one.
+       */
+      if (!has_default)
+	fprintf (yyout,
+		 "  default:\n"
+		 "    return FALSE;\n");
       fprintf (yyout,
 	       "  }\n"
 	       "  return TRUE;\n"
@@ -317,12 +618,25 @@ gen_union (const char *name, const struct decl *discrim,
 	       "\n");
       free (str);
       break;
+
+    case output_cxx:
+      gen_cxx_union (name, discrim, cases);
+      break;
     }
+
+  gen_union_size (name, discrim, cases);
+  gen_union_dir (name, discrim, cases);
 }
 
 void
 gen_typedef (const struct decl *decl)
 {
+  const struct type *type;
+
+  if (decl->decl_type == decl_type_simple &&
+      inline_units (decl->type, &type) > 0)
+    remember_type (decl->ident, type);
+
   gen_line ();
 
   switch (output_mode)
@@ -332,8 +646,7 @@ gen_typedef (const struct decl *decl)
       gen_decl (0, decl);
 
       fprintf (yyout,
-	       "extern bool_t xdr_%s (XDR *, %s *);\n"
-	       "\n",
+	       "extern bool_t xdr_%s (XDR *, %s *);\n",
 	       decl->ident, decl->ident);
       break;
 
@@ -343,13 +656,20 @@ gen_typedef (const struct decl *decl)
       fprintf (yyout, "xdr_%s (XDR *xdrs, %s *objp)\n",
 	       decl->ident, decl->ident);
       fprintf (yyout, "{\n");
-      gen_decl_xdr_call (2, decl, "&objp->");
+      gen_decl_xdr_call (2, decl, NULL);
       fprintf (yyout,
 	       "  return TRUE;\n"
 	       "}\n"
 	       "\n");
       break;
+
+    case output_cxx:
+      gen_cxx_typedef (decl);
+      break;
     }
+
+  gen_typedef_size (decl);
+  gen_typedef_dir (decl);
 }
 
 static void
@@ -482,64 +802,143 @@ sizeof_simple_type (const struct type *type)
   return r;
 }
 
+/* The object being encoded is prefix followed by the declared name
+ * (eg. "objp->" or "objp->foo_u."), or for typedefs (prefix NULL)
+ * the whole of *objp.  These print its address, the object itself,
+ * and a member of it when it is a struct.
+ */
+static void
+gen_addr (const struct decl *decl, const char *prefix)
+{
+  if (prefix)
+    fprintf (yyout, "&%s%s", prefix, decl->ident);
+  else
+    fputs ("objp", yyout);
+}
+
+static void
+gen_lval (const struct decl *decl, const char *prefix)
+{
+  if (prefix)
+    fprintf (yyout, "%s%s", prefix, decl->ident);
+  else
+    fputs ("*objp", yyout);
+}
+
+static void
+gen_member (const struct decl *decl, const char *prefix, const char *suffix)
+{
+  if (prefix)
+    fprintf (yyout, "%s%s.%s%s", prefix, decl->ident, decl->ident, suffix);
+  else
+    fprintf (yyout, "objp->%s%s", decl->ident, suffix);
+}
+
+/* Arrays of the basic types (and typedefs of them) have a function
+ * in the library which converts them in one go.  Return the name
+ * after the "xdr_vector_" prefix, or NULL for other types.  Arrays
+ * of bool are left to xdr_vector, because each value must be made
+ * TRUE or FALSE.
+ */
+static const char *
+vector_func_of_type (const struct type *type)
+{
+  const struct type *resolved = type;
+
+  if (type->type == type_ident && inline_units (type, &resolved) == 0)
+    return NULL;
+
+  switch (resolved->type) {
+  case type_char:
+    return resolved->sgn ? "int8" : "uint8";
+  case type_short:
+    return resolved->sgn ? "int16" : "uint16";
+  case type_int:
+    return resolved->sgn ? "int32" : "uint32";
+  case type_hyper:
+    return resolved->sgn ? "int64" : "uint64";
+  case type_float:
+    return "float";
+  case type_double:
+    return "double";
+  default:
+    return NULL;
+  }
+}
+
 static void
-gen_decl_xdr_call (int indent, const struct decl *decl, const char *struct_name)
+gen_decl_xdr_call (int indent, const struct decl *decl, const char *prefix)
 {
   char *str;
   char *len_str;
+  const char *vec;
 
   spaces (indent);
 
   switch (decl->decl_type)
     {
     case decl_type_string:
-      if (decl->len)
-	fprintf (yyout, "if (!xdr_string (xdrs, objp, %s))\n", decl->len);
-      else
-	fprintf (yyout, "if (!xdr_string (xdrs, objp, ~0))\n");
+      len_str = decl->len ? : "~0";
+      fputs ("if (!xdr_string (xdrs, ", yyout);
+      gen_addr (decl, prefix);
+      fprintf (yyout, ", %s))\n", len_str);
       break;
 
     case decl_type_opaque_fixed:
-      fprintf (yyout, "if (!xdr_opaque (xdrs, &objp, %s))\n", decl->len);
+      fputs ("if (!xdr_opaque (xdrs, ", yyout);
+      gen_lval (decl, prefix);
+      fprintf (yyout, ", %s))\n", decl->len);
       break;
 
     case decl_type_opaque_variable:
       len_str = decl->len ? : "~0";
-      fprintf (yyout,
-	       "if (!xdr_bytes (xdrs, %s%s.%s_val, %s%s.%s_len, %s))\n",
-	       struct_name, decl->ident, decl->ident,
-	       struct_name, decl->ident, decl->ident, len_str);
+      fputs ("if (!xdr_bytes (xdrs, &", yyout);
+      gen_member (decl, prefix, "_val");
+      fputs (", &", yyout);
+      gen_member (decl, prefix, "_len");
+      fprintf (yyout, ", %s))\n", len_str);
       break;
 
     case decl_type_simple:
-      fprintf (yyout, "if (!xdr_%s (xdrs, %s%s))\n",
-	       xdr_func_of_simple_type (decl->type), struct_name, decl->ident);
+      fprintf (yyout, "if (!xdr_%s (xdrs, ",
+	       xdr_func_of_simple_type (decl->type));
+      gen_addr (decl, prefix);
+      fputs ("))\n", yyout);
       break;
 
     case decl_type_fixed_array:
+      vec = vector_func_of_type (decl->type);
+      if (vec) {
+	fprintf (yyout, "if (!xdr_vector_%s (xdrs, ", vec);
+	gen_lval (decl, prefix);
+	fprintf (yyout, ", %s))\n", decl->len);
+	break;
+      }
       str = sizeof_simple_type (decl->type);
-      fprintf (yyout,
-	       "if (!xdr_vector (xdrs, %s%s, %s, %s, (xdrproc_t) xdr_%s))\n",
-	       struct_name, decl->ident, decl->len,
-	       str, xdr_func_of_simple_type (decl->type));
+      fputs ("if (!xdr_vector (xdrs, ", yyout);
+      gen_lval (decl, prefix);
+      fprintf (yyout, ", %s, %s, (xdrproc_t) xdr_%s))\n",
+	       decl->len, str, xdr_func_of_simple_type (decl->type));
       free (str);
       break;
 
     case decl_type_variable_array:
       str = sizeof_simple_type (decl->type);
       len_str = decl->len ? : "~0";
-      fprintf (yyout,
-	       "if (!xdr_array (xdrs, %s%s.%s_val, %s%s.%s_len, %s, %s, (xdrproc_t) xdr_%s))\n",
-	       struct_name, decl->ident, decl->ident,
-	       struct_name, decl->ident, decl->ident,
-	       len_str,
-	       str, xdr_func_of_simple_type (decl->type));
+      fputs ("if (!xdr_array (xdrs, (char **) &", yyout);
+      gen_member (decl, prefix, "_val");
+      fputs (", &", yyout);
+      gen_member (decl, prefix, "_len");
+      fprintf (yyout, ", %s, %s, (xdrproc_t) xdr_%s))\n",
+	       len_str, str, xdr_func_of_simple_type (decl->type));
       free (str);
       break;
 
     case decl_type_pointer:
       str = sizeof_simple_type (decl->type);
-      fprintf (yyout, "if (!xdr_pointer (xdrs, objp, %s, (xdrproc_t) xdr_%s))\n",
+      fputs ("if (!xdr_pointer (xdrs, (char **) ", yyout);
+      gen_addr (decl, prefix);
+      fprintf (yyout, ", %s, (xdrproc_t) xdr_%s))\n",
 	       str, xdr_func_of_simple_type (decl->type));
       free (str);
       break;
@@ -591,3 +990,1466 @@ gen_type (const struct type *type)
       break;
     }
 }
+
+/* Encoded sizes.
+ *
+ * For each type we work out whether every value encodes to the same
+ * number of bytes, and if not, whether there is a maximum.  Types
+ * with a fixed size get a NAME_XDR_SIZE constant, and all others get
+ * a function xdr_NAME_size which adds the variable parts of a value
+ * to the sum of its fixed parts.  Types whose size is bounded also
+ * get NAME_XDR_MAXSIZE.
+ *
+ * Lengths must be integer literals or constants defined earlier in
+ * the input to be used here.  Other lengths, types from other input
+ * files and recursive types are treated as unbounded, and values of
+ * unknown types are measured at run time with xdr_sizeof.
+ */
+
+/* Sizes above this are treated as unbounded. */
+#define SIZE_LIMIT 0xffffffffULL
+
+/* Round up to a whole number of XDR units. */
+#define UNITS(n) (((n) + 3) & ~3ULL)
+
+struct size_info {
+  int fixed;			/* every value has the same size */
+  int bounded;			/* max is an upper bound on the size */
+  unsigned long long size;	/* the size, if fixed */
+  unsigned long long max;	/* the maximum size, if bounded */
+  int has_fn;			/* xdr_NAME_size exists */
+};
+
+struct sized_type {
+  struct sized_type *next;
+  char *name;
+  struct size_info info;
+};
+
+struct known_const {
+  struct known_const *next;
+  char *name;
+  unsigned long long value;
+};
+
+static struct sized_type *sized_types = NULL;
+static struct known_const *known_consts = NULL;
+
+static void
+forget_sizes (void)
+{
+  struct sized_type *t, *tnext;
+  struct known_const *c, *cnext;
+
+  for (t = sized_types; t; t = tnext) {
+    tnext = t->next;
+    free (t->name);
+    free (t);
+  }
+  sized_types = NULL;
+  for (c = known_consts; c; c = cnext) {
+    cnext = c->next;
+    free (c->name);
+    free (c);
+  }
+  known_consts = NULL;
+}
+
+/* Get the value of a length (an integer literal or a constant). */
+static int
+eval_len (const char *len, unsigned long long *r)
+{
+  const struct known_const *c;
+  char *end;
+
+  if (len == NULL)
+    return 0;
+  if (isdigit ((unsigned char) *len)) {
+    *r = strtoull (len, &end, 0);
+    return *end == '\0' && *r <= SIZE_LIMIT;
+  }
+  for (c = known_consts; c; c = c->next)
+    if (strcmp (c->name, len) == 0) {
+      *r = c->value;
+      return 1;
+    }
+  return 0;
+}
+
+static void
+remember_const (const char *name, const char *value)
+{
+  struct known_const *c;
+  unsigned long long v;
+
+  if (!eval_len (value, &v))
+    return;
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    perrorf ("malloc");
+  c->name = strdup (name);
+  if (c->name == NULL)
+    perrorf ("strdup");
+  c->value = v;
+  c->next = known_consts;
+  known_consts = c;
+}
+
+static struct size_info *
+remember_size (const char *name, const struct size_info *info)
+{
+  struct sized_type *t = malloc (sizeof *t);
+
+  if (t == NULL)
+    perrorf ("malloc");
+  t->name = strdup (name);
+  if (t->name == NULL)
+    perrorf ("strdup");
+  t->info = *info;
+  t->next = sized_types;
+  sized_types = t;
+  return &t->info;
+}
+
+static void
+size_fixed (struct size_info *si, unsigned long long n)
+{
+  si->fixed = si->bounded = 1;
+  si->size = si->max = n;
+  si->has_fn = 0;
+}
+
+static void
+size_unknown (struct size_info *si)
+{
+  si->fixed = si->bounded = 0;
+  si->size = si->max = 0;
+  si->has_fn = 0;
+}
+
+/* Combine sizes, remembering that the sum or product of two bounded
+ * sizes might be too big.
+ */
+static void
+size_add (struct size_info *si, const struct size_info *a)
+{
+  si->fixed = si->fixed && a->fixed;
+  si->size += a->size;
+  si->bounded = si->bounded && a->bounded && si->max + a->max <= SIZE_LIMIT;
+  si->max += a->max;
+  if (si->fixed && !si->bounded)
+    si->fixed = 0;
+}
+
+static void
+size_mul (struct size_info *si, unsigned long long n)
+{
+  if (n > 0 && si->max > SIZE_LIMIT / n)
+    si->fixed = si->bounded = 0;
+  si->size *= n;
+  si->max *= n;
+}
+
+static void
+type_size (const struct type *type, struct size_info *si)
+{
+  const struct sized_type *t;
+
+  switch (type->type) {
+  case type_char: case type_short: case type_int:
+  case type_float: case type_bool:
+    size_fixed (si, 4);
+    return;
+  case type_hyper: case type_double:
+    size_fixed (si, 8);
+    return;
+  case type_ident:
+    for (t = sized_types; t; t = t->next)
+      if (strcmp (t->name, type->ident) == 0) {
+	*si = t->info;
+	return;
+      }
+    size_unknown (si);
+    return;
+  }
+}
+
+static void
+decl_size (const struct decl *decl, struct size_info *si)
+{
+  struct size_info four;
+  unsigned long long n;
+
+  size_fixed (&four, 4);
+
+  switch (decl->decl_type)
+    {
+    case decl_type_string:
+    case decl_type_opaque_variable:
+      size_unknown (si);
+      if (eval_len (decl->len, &n)) {
+	si->bounded = 1;
+	si->max = 4 + UNITS (n);
+      }
+      break;
+
+    case decl_type_opaque_fixed:
+      if (eval_len (decl->len, &n))
+	size_fixed (si, UNITS (n));
+      else
+	size_unknown (si);
+      break;
+
+    case decl_type_simple:
+      type_size (decl->type, si);
+      break;
+
+    case decl_type_fixed_array:
+      type_size (decl->type, si);
+      if (eval_len (decl->len, &n))
+	size_mul (si, n);
+      else
+	si->fixed = si->bounded = 0;
+      break;
+
+    case decl_type_variable_array:
+      type_size (decl->type, si);
+      si->fixed = 0;
+      if (eval_len (decl->len, &n))
+	size_mul (si, n);
+      else
+	si->bounded = 0;
+      size_add (si, &four);
+      break;
+
+    case decl_type_pointer:
+      type_size (decl->type, si);
+      si->fixed = 0;
+      size_add (si, &four);
+      break;
+    }
+}
+
+static void
+gen_caps (const char *name)
+{
+  for (; *name; ++name)
+    fputc (isalnum ((unsigned char) *name) ?
+	   toupper ((unsigned char) *name) : '_', yyout);
+}
+
+/* Print the declarations in the header file for a type. */
+static void
+gen_size_h (const char *name, const struct size_info *si)
+{
+  if (si->fixed) {
+    fputs ("#define ", yyout);
+    gen_caps (name);
+    fprintf (yyout, "_XDR_SIZE %llu\n", si->size);
+  }
+  if (si->bounded) {
+    fputs ("#define ", yyout);
+    gen_caps (name);
+    fprintf (yyout, "_XDR_MAXSIZE %llu\n", si->max);
+  }
+  if (!si->fixed)
+    fprintf (yyout, "extern size_t xdr_%s_size (const %s *);\n", name, name);
+  fputc ('\n', yyout);
+}
+
+/* Print an expression for the size of the value of type at addr. */
+static void
+gen_value_size (const struct type *type, const char *addr)
+{
+  struct size_info si;
+
+  type_size (type, &si);
+  if (si.fixed)
+    fprintf (yyout, "%llu", si.size);
+  else if (si.has_fn)
+    fprintf (yyout, "xdr_%s_size (%s)", type->ident, addr);
+  else
+    fprintf (yyout, "xdr_sizeof ((xdrproc_t) xdr_%s, (void *) %s)",
+	     xdr_func_of_simple_type (type), addr);
+}
+
+/* Does measuring the decl at run time need a loop? */
+static int
+decl_size_loops (const struct decl *decl)
+{
+  struct size_info si;
+
+  if (decl->decl_type != decl_type_fixed_array &&
+      decl->decl_type != decl_type_variable_array)
+    return 0;
+  type_size (decl->type, &si);
+  return !si.fixed;
+}
+
+/* Print statements which add the size of a decl to 'size', or add
+ * it to *fixed if that is known now.  prefix is as for
+ * gen_decl_xdr_call.
+ */
+static void
+gen_decl_size (int indent, const struct decl *decl, const char *prefix,
+	       unsigned long long *fixed)
+{
+  struct size_info si, elem;
+  char *addr;
+  int len;
+
+  decl_size (decl, &si);
+  if (si.fixed) {
+    *fixed += si.size;
+    return;
+  }
+
+  len = (prefix ? strlen (prefix) : 0) + 2 * strlen (decl->ident) + 16;
+  addr = malloc (len);
+  if (addr == NULL)
+    perrorf ("malloc");
+
+  spaces (indent);
+
+  switch (decl->decl_type)
+    {
+    case decl_type_string:
+      *fixed += 4;
+      fputs ("size += RNDUP (", yyout);
+      gen_lval (decl, prefix);
+      fputs (" ? strlen (", yyout);
+      gen_lval (decl, prefix);
+      fputs (") : 0);\n", yyout);
+      break;
+
+    case decl_type_opaque_fixed:
+      fprintf (yyout, "size += RNDUP (%s);\n", decl->len);
+      break;
+
+    case decl_type_opaque_variable:
+      *fixed += 4;
+      fputs ("size += RNDUP (", yyout);
+      gen_member (decl, prefix, "_len");
+      fputs (");\n", yyout);
+      break;
+
+    case decl_type_simple:
+      if (prefix)
+	snprintf (addr, len, "&%s%s", prefix, decl->ident);
+      else
+	snprintf (addr, len, "objp");
+      fputs ("size += ", yyout);
+      gen_value_size (decl->type, addr);
+      fputs (";\n", yyout);
+      break;
+
+    case decl_type_fixed_array:
+      type_size (decl->type, &elem);
+      if (elem.fixed) {
+	fprintf (yyout, "size += (size_t) %s * %llu;\n", decl->len, elem.size);
+	break;
+      }
+      if (prefix)
+	snprintf (addr, len, "&%s%s[i]", prefix, decl->ident);
+      else
+	snprintf (addr, len, "&(*objp)[i]");
+      fprintf (yyout, "for (i = 0; i < %s; ++i)\n", decl->len);
+      spaces (indent+2);
+      fputs ("size += ", yyout);
+      gen_value_size (decl->type, addr);
+      fputs (";\n", yyout);
+      break;
+
+    case decl_type_variable_array:
+      *fixed += 4;
+      type_size (decl->type, &elem);
+      if (elem.fixed) {
+	fputs ("size += (size_t) ", yyout);
+	gen_member (decl, prefix, "_len");
+	fprintf (yyout, " * %llu;\n", elem.size);
+	break;
+      }
+      if (prefix)
+	snprintf (addr, len, "&%s%s.%s_val[i]", prefix, decl->ident, decl->ident);
+      else
+	snprintf (addr, len, "&objp->%s_val[i]", decl->ident);
+      fputs ("for (i = 0; i < ", yyout);
+      gen_member (decl, prefix, "_len");
+      fputs ("; ++i)\n", yyout);
+      spaces (indent+2);
+      fputs ("size += ", yyout);
+      gen_value_size (decl->type, addr);
+      fputs (";\n", yyout);
+      break;
+
+    case decl_type_pointer:
+      *fixed += 4;
+      if (prefix)
+	snprintf (addr, len, "%s%s", prefix, decl->ident);
+      else
+	snprintf (addr, len, "*objp");
+      fprintf (yyout, "if (%s)\n", addr);
+      spaces (indent+2);
+      fputs ("size += ", yyout);
+      gen_value_size (decl->type, addr);
+      fputs (";\n", yyout);
+      break;
+    }
+
+  free (addr);
+}
+
+static void
+gen_size_fn_start (const char *name, int loops)
+{
+  fprintf (yyout,
+	   "size_t\n"
+	   "xdr_%s_size (const %s *objp)\n"
+	   "{\n"
+	   "  size_t size = 0;\n",
+	   name, name);
+  if (loops)
+    fputs ("  size_t i;\n", yyout);
+  fputc ('\n', yyout);
+}
+
+static void
+gen_size_fn_end (unsigned long long fixed)
+{
+  if (fixed > 0)
+    fprintf (yyout, "  size += %llu;\n", fixed);
+  fputs ("  return size;\n"
+	 "}\n"
+	 "\n", yyout);
+}
+
+static void
+gen_enum_size (const char *name)
+{
+  struct size_info si;
+
+  size_fixed (&si, 4);
+  remember_size (name, &si);
+  if (output_mode == output_h)
+    gen_size_h (name, &si);
+}
+
+static void
+gen_struct_size (const char *name, const struct cons *decls)
+{
+  struct size_info si, field, *entry;
+  const struct cons *d;
+  unsigned long long fixed = 0;
+  int loops = 0;
+
+  /* Fields which point back to this struct see it as unbounded. */
+  size_fixed (&si, 0);
+  si.fixed = si.bounded = 0;
+  si.has_fn = 1;
+  entry = remember_size (name, &si);
+
+  size_fixed (&si, 0);
+  for (d = decls; d; d = d->next) {
+    decl_size ((const struct decl *) d->ptr, &field);
+    size_add (&si, &field);
+    loops |= decl_size_loops ((const struct decl *) d->ptr);
+  }
+  si.has_fn = !si.fixed;
+  *entry = si;
+
+  if (output_mode == output_h)
+    gen_size_h (name, &si);
+  else if (output_mode == output_c && !si.fixed) {
+    gen_size_fn_start (name, loops);
+    for (d = decls; d; d = d->next)
+      gen_decl_size (2, (const struct decl *) d->ptr, "objp->", &fixed);
+    gen_size_fn_end (fixed);
+  }
+}
+
+static void
+gen_union_size (const char *name, const struct decl *discrim,
+		const struct cons *union_cases)
+{
+  struct size_info si, arm, *entry;
+  const struct cons *c;
+  const struct union_case *uc;
+  unsigned long long fixed, size = 0, max = 0;
+  char *prefix;
+  int len, loops = 0, first = 1, same = 1, bounded = 1, has_default;
+
+  size_fixed (&si, 0);
+  si.fixed = si.bounded = 0;
+  si.has_fn = 1;
+  entry = remember_size (name, &si);
+
+  /* The union has a fixed size if every arm has the same fixed size,
+   * and it is bounded if every arm is.
+   */
+  for (c = union_cases; c; c = c->next) {
+    uc = (const struct union_case *) c->ptr;
+    if (uc->decl) {
+      decl_size (uc->decl, &arm);
+      loops |= decl_size_loops (uc->decl);
+    }
+    else
+      size_fixed (&arm, 0);
+    if (!arm.fixed || (!first && arm.size != size))
+      same = 0;
+    size = arm.size;
+    first = 0;
+    if (!arm.bounded)
+      bounded = 0;
+    else if (arm.max > max)
+      max = arm.max;
+  }
+  si.fixed = same;
+  si.size = same ? size : 0;
+  si.bounded = bounded;
+  si.max = max;
+  /* The discriminant is an int, unsigned int, enum or bool, so it is
+   * always one unit, even if its type is from another input file.
+   */
+  size_fixed (&arm, 4);
+  size_add (&si, &arm);
+  si.has_fn = !si.fixed;
+  *entry = si;
+
+  if (output_mode == output_h) {
+    gen_size_h (name, &si);
+    return;
+  }
+  if (output_mode != output_c || si.fixed)
+    return;
+
+  len = strlen (name) + 10;
+  prefix = malloc (len);
+  if (prefix == NULL)
+    perrorf ("malloc");
+  snprintf (prefix, len, "objp->%s_u.", name);
+
+  gen_size_fn_start (name, loops);
+  fprintf (yyout, "  switch (objp->%s) {\n", discrim->ident);
+  has_default = 0;
+  for (c = union_cases; c; c = c->next) {
+    uc = (const struct union_case *) c->ptr;
+    if (uc->type == union_case_normal)
+      fprintf (yyout, "  case %s:\n", uc->const_);
+    else {
+      fprintf (yyout, "  default:\n");
+      has_default = 1;
+    }
+    fixed = 0;
+    if (uc->decl)
+      gen_decl_size (4, uc->decl, prefix, &fixed);
+    if (fixed > 0)
+      fprintf (yyout, "    size += %llu;\n", fixed);
+    fprintf (yyout, "    break;\n");
+  }
+  if (!has_default)
+    fprintf (yyout,
+	     "  default:\n"
+	     "    break;\n");
+  fprintf (yyout, "  }\n");
+  gen_size_fn_end (4);
+  free (prefix);
+}
+
+static void
+gen_typedef_size (const struct decl *decl)
+{
+  struct size_info si;
+  unsigned long long fixed = 0;
+
+  decl_size (decl, &si);
+  si.has_fn = !si.fixed;
+  remember_size (decl->ident, &si);
+
+  if (output_mode == output_h)
+    gen_size_h (decl->ident, &si);
+  else if (output_mode == output_c && !si.fixed) {
+    gen_size_fn_start (decl->ident, decl_size_loops (decl));
+    gen_decl_size (2, decl, NULL, &fixed);
+    gen_size_fn_end (fixed);
+  }
+}
+
+/* Direction-specific functions (-e option).
+ *
+ * Each type also gets xdr_NAME_encode, xdr_NAME_decode and
+ * xdr_NAME_free, as static inline functions in the header file with
+ * the same arguments as xdr_NAME.  These never look at x_op.  The
+ * basic types are converted with the xdr_encode_* and xdr_decode_*
+ * functions from <rpc/xdr.h>, and values of other types defined in
+ * this input with the function for the same direction, so that the
+ * compiler can turn a whole message into straight-line code.
+ *
+ * Strings, opaque data, variable-length arrays and optional data are
+ * still handled by the library functions, which know about
+ * allocation and the stream flags.  They are passed the element
+ * function for the same direction, except when decoding (see
+ * gen_elem_proc).  xdr_NAME_free only visits the fields which can
+ * own memory.  Types from other input files are
+ * handled by their xdr_NAME function.
+ */
+
+enum direction { dir_encode, dir_decode, dir_free };
+
+static const char *dir_names[] = { "encode", "decode", "free" };
+
+/* Is this a type defined earlier in the input?  Every type defined
+ * has its size remembered, so look there.
+ */
+static int
+local_type (const struct type *type)
+{
+  const struct sized_type *t;
+
+  if (type->type != type_ident)
+    return 0;
+  for (t = sized_types; t; t = t->next)
+    if (strcmp (t->name, type->ident) == 0)
+      return 1;
+  return 0;
+}
+
+/* Only values which vary in size can own memory. */
+static int
+decl_owns_memory (const struct decl *decl)
+{
+  struct size_info si;
+
+  decl_size (decl, &si);
+  return !si.fixed;
+}
+
+/* The name of a direction-specific function for a basic type, after
+ * the "xdr_encode_" or "xdr_decode_" prefix.
+ */
+static const char *
+dir_func_of_basic_type (const struct type *type, enum direction dir)
+{
+  switch (type->type) {
+  case type_char:
+    if (dir == dir_encode) return type->sgn ? "int32" : "uint32";
+    return type->sgn ? "int8" : "uint8";
+  case type_short:
+    if (dir == dir_encode) return type->sgn ? "int32" : "uint32";
+    return type->sgn ? "int16" : "uint16";
+  case type_int:
+    return type->sgn ? "int32" : "uint32";
+  case type_hyper:
+    return type->sgn ? "int64" : "uint64";
+  case type_float:
+    return "float";
+  case type_double:
+    return "double";
+  case type_bool:
+    return "bool";
+  default: abort ();		/* Avoid GCC warning. */
+  }
+}
+
+/* Print the function which converts values of type, for passing to
+ * the library as an xdrproc_t.
+ */
+static void
+gen_dir_proc (const struct type *type, enum direction dir)
+{
+  if (local_type (type))
+    fprintf (yyout, "xdr_%s_%s", type->ident, dir_names[dir]);
+  else
+    fprintf (yyout, "xdr_%s", xdr_func_of_simple_type (type));
+}
+
+/* Print the element function passed to xdr_array or xdr_pointer.
+ * With XDR_DECODE_REUSE these free the elements which they no longer
+ * need by calling the element function with XDR_FREE, which
+ * xdr_NAME_decode doesn't handle, so decoding uses xdr_NAME.
+ */
+static void
+gen_elem_proc (const struct type *type, enum direction dir)
+{
+  if (dir == dir_decode)
+    fprintf (yyout, "xdr_%s", xdr_func_of_simple_type (type));
+  else
+    gen_dir_proc (type, dir);
+}
+
+/* Print the statement which converts the value lval of type.  For
+ * typedefs, lval is the whole of *objp.
+ */
+static void
+gen_dir_value (int indent, const struct type *type, const char *lval,
+	       enum direction dir)
+{
+  const char *addr = lval;
+  const char *amp = "&";
+
+  if (strcmp (lval, "*objp") == 0) {
+    addr = "objp";
+    amp = "";
+  }
+
+  spaces (indent);
+  if (type->type == type_ident) {
+    fputs ("if (!", yyout);
+    gen_dir_proc (type, dir);
+    fprintf (yyout, " (xdrs, %s%s))\n", amp, addr);
+  }
+  else if (dir == dir_encode)
+    fprintf (yyout, "if (!xdr_encode_%s (xdrs, %s))\n",
+	     dir_func_of_basic_type (type, dir), lval);
+  else
+    fprintf (yyout, "if (!xdr_decode_%s (xdrs, %s%s))\n",
+	     dir_func_of_basic_type (type, dir), amp, addr);
+  spaces (indent+2);
+  fputs ("return FALSE;\n", yyout);
+}
+
+/* Does converting the decl in this direction need a loop? */
+static int
+decl_dir_loops (const struct decl *decl, enum direction dir)
+{
+  return decl->decl_type == decl_type_fixed_array &&
+    decl->type->type == type_ident && !vector_func_of_type (decl->type) &&
+    (dir != dir_free || decl_owns_memory (decl));
+}
+
+/* Print the statements which convert a decl.  prefix is as for
+ * gen_decl_xdr_call.
+ */
+static void
+gen_decl_dir (int indent, const struct decl *decl, const char *prefix,
+	      enum direction dir)
+{
+  char *lval, *str;
+  const char *len_str;
+  int len;
+
+  if (dir == dir_free && !decl_owns_memory (decl))
+    return;
+
+  len = (prefix ? strlen (prefix) : 0) + strlen (decl->ident) + 16;
+  lval = malloc (len);
+  if (lval == NULL)
+    perrorf ("malloc");
+
+  switch (decl->decl_type)
+    {
+    case decl_type_string:
+    case decl_type_opaque_fixed:
+    case decl_type_opaque_variable:
+      gen_decl_xdr_call (indent, decl, prefix);
+      break;
+
+    case decl_type_simple:
+      if (prefix)
+	snprintf (lval, len, "%s%s", prefix, decl->ident);
+      else
+	snprintf (lval, len, "*objp");
+      gen_dir_value (indent, decl->type, lval, dir);
+      break;
+
+    case decl_type_fixed_array:
+      /* Arrays of basic types are converted in one go. */
+      if (decl->type->type != type_ident || vector_func_of_type (decl->type)) {
+	gen_decl_xdr_call (indent, decl, prefix);
+	break;
+      }
+      if (prefix)
+	snprintf (lval, len, "%s%s[i]", prefix, decl->ident);
+      else
+	snprintf (lval, len, "(*objp)[i]");
+      spaces (indent);
+      fprintf (yyout, "for (i = 0; i < %s; ++i)\n", decl->len);
+      gen_dir_value (indent+2, decl->type, lval, dir);
+      break;
+
+    case decl_type_variable_array:
+      str = sizeof_simple_type (decl->type);
+      len_str = decl->len ? : "~0";
+      spaces (indent);
+      fputs ("if (!xdr_array (xdrs, (char **) &", yyout);
+      gen_member (decl, prefix, "_val");
+      fputs (", &", yyout);
+      gen_member (decl, prefix, "_len");
+      fprintf (yyout, ", %s, %s, (xdrproc_t) ", len_str, str);
+      gen_elem_proc (decl->type, dir);
+      fputs ("))\n", yyout);
+      spaces (indent+2);
+      fputs ("return FALSE;\n", yyout);
+      free (str);
+      break;
+
+    case decl_type_pointer:
+      str = sizeof_simple_type (decl->type);
+      spaces (indent);
+      fputs ("if (!xdr_pointer (xdrs, (char **) ", yyout);
+      gen_addr (decl, prefix);
+      fprintf (yyout, ", %s, (xdrproc_t) ", str);
+      gen_elem_proc (decl->type, dir);
+      fputs ("))\n", yyout);
+      spaces (indent+2);
+      fputs ("return FALSE;\n", yyout);
+      free (str);
+      break;
+    }
+
+  free (lval);
+}
+
+/* The same as gen_inline_block, for one direction. */
+static void
+gen_dir_inline_block (const struct cons *decls, int n, int units,
+		      enum direction dir)
+{
+  const struct cons *d;
+  const struct decl *decl;
+  const struct type *type;
+  int i;
+
+  fprintf (yyout,
+	   "  if ((buf = (int32_t *) xdr_inline (xdrs, %d * BYTES_PER_XDR_UNIT)) != NULL) {\n",
+	   units);
+  for (d = decls, i = 0; i < n; d = d->next, ++i) {
+    decl = (const struct decl *) d->ptr;
+    inline_units (decl->type, &type);
+    if (dir == dir_decode) {
+      fprintf (yyout, "    objp->%s = ", decl->ident);
+      gen_inline_get (type);
+      fputs (";\n", yyout);
+    }
+    else {
+      spaces (4);
+      gen_inline_put (type, "objp->", decl->ident);
+    }
+  }
+  fprintf (yyout,
+	   "  }\n"
+	   "  else {\n");
+  for (d = decls, i = 0; i < n; d = d->next, ++i)
+    gen_decl_dir (4, (const struct decl *) d->ptr, "objp->", dir);
+  fprintf (yyout,
+	   "  }\n");
+}
+
+/* Structs and unions can contain pointers to themselves. */
+static void
+gen_dir_decls (const char *name)
+{
+  enum direction dir;
+
+  for (dir = dir_encode; dir <= dir_free; dir++)
+    fprintf (yyout, "static inline bool_t xdr_%s_%s (XDR *, %s *);\n",
+	     name, dir_names[dir], name);
+  fputc ('\n', yyout);
+}
+
+/* used is false if the function has nothing to do. */
+static void
+gen_dir_fn_start (const char *name, enum direction dir, int used,
+		  int loops, int use_buf)
+{
+  const char *unused = used ? "" : " ATTRIBUTE_UNUSED";
+
+  fprintf (yyout,
+	   "static inline bool_t\n"
+	   "xdr_%s_%s (XDR *xdrs%s, %s *objp%s)\n"
+	   "{\n",
+	   name, dir_names[dir], unused, name, unused);
+  if (use_buf)
+    fputs ("  int32_t *buf;\n", yyout);
+  if (loops)
+    fputs ("  size_t i;\n", yyout);
+  if (use_buf || loops)
+    fputc ('\n', yyout);
+}
+
+static void
+gen_dir_fn_end (void)
+{
+  fputs ("  return TRUE;\n"
+	 "}\n"
+	 "\n", yyout);
+}
+
+static void
+gen_enum_dir (const char *name)
+{
+  if (!direction_functions || output_mode != output_h)
+    return;
+
+  gen_dir_fn_start (name, dir_encode, 1, 0, 0);
+  fputs ("  if (!xdr_encode_enum (xdrs, *objp))\n"
+	 "    return FALSE;\n", yyout);
+  gen_dir_fn_end ();
+  gen_dir_fn_start (name, dir_decode, 1, 0, 0);
+  fputs ("  if (!xdr_decode_enum (xdrs, (enum_t *) objp))\n"
+	 "    return FALSE;\n", yyout);
+  gen_dir_fn_end ();
+  gen_dir_fn_start (name, dir_free, 0, 0, 0);
+  gen_dir_fn_end ();
+}
+
+static void
+gen_struct_dir (const char *name, const struct cons *decls)
+{
+  enum direction dir;
+  const struct cons *d;
+  const struct decl *decl;
+  int n, units, used, loops, use_inline;
+
+  if (!direction_functions || output_mode != output_h)
+    return;
+
+  gen_dir_decls (name);
+  for (dir = dir_encode; dir <= dir_free; dir++) {
+    used = dir != dir_free;
+    loops = use_inline = 0;
+    for (d = decls; d; d = d->next) {
+      decl = (const struct decl *) d->ptr;
+      if (dir != dir_free && inline_threshold > 0 &&
+	  inline_run (d, &units) >= inline_threshold)
+	use_inline = 1;
+      if (dir == dir_free && decl_owns_memory (decl))
+	used = 1;
+      loops |= decl_dir_loops (decl, dir);
+    }
+
+    gen_dir_fn_start (name, dir, used, loops, use_inline);
+    for (d = decls; d; ) {
+      n = use_inline ? inline_run (d, &units) : 0;
+      if (n >= inline_threshold && n > 0) {
+	gen_dir_inline_block (d, n, units, dir);
+	while (n-- > 0)
+	  d = d->next;
+      }
+      else {
+	gen_decl_dir (2, (const struct decl *) d->ptr, "objp->", dir);
+	d = d->next;
+      }
+    }
+    gen_dir_fn_end ();
+  }
+}
+
+static void
+gen_union_dir (const char *name, const struct decl *discrim,
+	       const struct cons *union_cases)
+{
+  enum direction dir;
+  const struct cons *c;
+  const struct union_case *uc;
+  char *prefix;
+  int len, used, loops, has_default;
+
+  if (!direction_functions || output_mode != output_h)
+    return;
+
+  len = strlen (name) + 10;
+  prefix = malloc (len);
+  if (prefix == NULL)
+    perrorf ("malloc");
+  snprintf (prefix, len, "objp->%s_u.", name);
+
+  gen_dir_decls (name);
+  for (dir = dir_encode; dir <= dir_free; dir++) {
+    used = dir != dir_free;
+    loops = 0;
+    for (c = union_cases; c; c = c->next) {
+      uc = (const struct union_case *) c->ptr;
+      if (uc->decl == NULL)
+	continue;
+      if (dir == dir_free && decl_owns_memory (uc->decl))
+	used = 1;
+      loops |= decl_dir_loops (uc->decl, dir);
+    }
+
+    gen_dir_fn_start (name, dir, used, loops, 0);
+    if (!used) {
+      gen_dir_fn_end ();
+      continue;
+    }
+    gen_decl_dir (2, discrim, "objp->", dir);
+    fprintf (yyout, "  switch (objp->%s) {\n", discrim->ident);
+    has_default = 0;
+    for (c = union_cases; c; c = c->next) {
+      uc = (const struct union_case *) c->ptr;
+      /* When freeing, arms which own no memory go to the default. */
+      if (dir == dir_free && (uc->decl == NULL || !decl_owns_memory (uc->decl)))
+	continue;
+      if (uc->type == union_case_normal)
+	fprintf (yyout, "  case %s:\n", uc->const_);
+      else {
+	fprintf (yyout, "  default:\n");
+	has_default = 1;
+      }
+      if (uc->decl)
+	gen_decl_dir (4, uc->decl, prefix, dir);
+      fprintf (yyout, "    break;\n");
+    }
+    if (!has_default)
+      fprintf (yyout,
+	       "  default:\n"
+	       "    %s;\n",
+	       dir == dir_free ? "break" : "return FALSE");
+    fprintf (yyout, "  }\n");
+    gen_dir_fn_end ();
+  }
+
+  free (prefix);
+}
+
+static void
+gen_typedef_dir (const struct decl *decl)
+{
+  enum direction dir;
+
+  if (!direction_functions || output_mode != output_h)
+    return;
+
+  for (dir = dir_encode; dir <= dir_free; dir++) {
+    gen_dir_fn_start (decl->ident, dir,
+		      dir != dir_free || decl_owns_memory (decl),
+		      decl_dir_loops (decl, dir), 0);
+    gen_decl_dir (2, decl, NULL, dir);
+    gen_dir_fn_end ();
+  }
+}
+
+/* C++ output (-x option).
+ *
+ * The types are declared in a namespace named after the output file,
+ * using std::string, std::vector, std::array and std::optional, and
+ * each enum, struct and union gets a specialisation of
+ * portable_xdr::codec from <rpc/xdr_codec.hpp>.  For structs and
+ * unions the codec calls inline functions encode and decode in the
+ * namespace, which convert the fields directly, with no C structure
+ * in between.  They are declared before the codec and defined after
+ * it, so that recursive types work, and being in the namespace they
+ * can use its names unqualified even when the C header is included
+ * too.  A field is handled by the codec for its declaration, which
+ * carries the bounds and the element codec as template arguments.
+ * A typedef NAME is an alias, so its codec is a class NAME_codec next
+ * to it instead.
+ *
+ * Pointers to the type being declared (as in linked lists) are
+ * std::unique_ptr, because std::optional needs a complete type.
+ * Union arms are ordinary members, of which only the one selected by
+ * the discriminant is encoded or decoded.  Constants are macros as
+ * in the C header, so that both headers can be used together.
+ */
+
+static char *cxx_namespace = NULL;
+static struct cons *cxx_typedefs = NULL;
+
+/* The namespace is the basename of the output file, made into an
+ * identifier.
+ */
+static void
+set_cxx_namespace (void)
+{
+  const char *p = strrchr (output_filename, '/');
+  const char *q = strrchr (output_filename, '.');
+  char *r;
+
+  p = p ? p + 1 : output_filename;
+  if (q == NULL || q < p)
+    q = p + strlen (p);
+
+  free (cxx_namespace);
+  cxx_namespace = r = malloc (q - p + 2);
+  if (r == NULL)
+    perrorf ("malloc");
+  if (isdigit (*p) || p == q)
+    *r++ = '_';
+  for (; p < q; ++p)
+    *r++ = isalnum (*p) ? *p : '_';
+  *r = '\0';
+
+  list_free (cxx_typedefs);
+  cxx_typedefs = NULL;
+}
+
+static int
+cxx_typedef (const struct type *type)
+{
+  const struct cons *c;
+
+  if (type->type != type_ident)
+    return 0;
+  for (c = cxx_typedefs; c; c = c->next)
+    if (strcmp ((const char *) c->ptr, type->ident) == 0)
+      return 1;
+  return 0;
+}
+
+static void
+gen_cxx_type (const struct type *type)
+{
+  if (type->type == type_bool)
+    fputs ("bool", yyout);
+  else
+    gen_type (type);
+}
+
+static void
+gen_cxx_codec (const struct type *type)
+{
+  if (cxx_typedef (type))
+    fprintf (yyout, "%s_codec", type->ident);
+  else {
+    fputs ("portable_xdr::codec<", yyout);
+    gen_cxx_type (type);
+    fputc ('>', yyout);
+  }
+}
+
+/* The C++ type of a declaration.  self is the name of the type
+ * being declared, or NULL.
+ */
+static void
+gen_cxx_decl_type (const struct decl *decl, const char *self)
+{
+  switch (decl->decl_type)
+    {
+    case decl_type_string:
+      fputs ("std::string", yyout);
+      break;
+
+    case decl_type_opaque_fixed:
+      fprintf (yyout, "std::array<uint8_t, %s>", decl->len);
+      break;
+
+    case decl_type_opaque_variable:
+      fputs ("std::vector<uint8_t>", yyout);
+      break;
+
+    case decl_type_simple:
+      gen_cxx_type (decl->type);
+      break;
+
+    case decl_type_fixed_array:
+      fputs ("std::array<", yyout);
+      gen_cxx_type (decl->type);
+      fprintf (yyout, ", %s>", decl->len);
+      break;
+
+    case decl_type_variable_array:
+      fputs ("std::vector<", yyout);
+      gen_cxx_type (decl->type);
+      fputc ('>', yyout);
+      break;
+
+    case decl_type_pointer:
+      if (self && decl->type->type == type_ident &&
+	  strcmp (decl->type->ident, self) == 0)
+	fputs ("std::unique_ptr<", yyout);
+      else
+	fputs ("std::optional<", yyout);
+      gen_cxx_type (decl->type);
+      fputc ('>', yyout);
+      break;
+    }
+}
+
+static void
+gen_cxx_decl_codec (const struct decl *decl)
+{
+  switch (decl->decl_type)
+    {
+    case decl_type_string:
+      fprintf (yyout, "portable_xdr::string_codec<%s>",
+	       decl->len ? decl->len : "");
+      break;
+
+    case decl_type_opaque_fixed:
+      fputs ("portable_xdr::fixed_opaque_codec", yyout);
+      break;
+
+    case decl_type_opaque_variable:
+      fprintf (yyout, "portable_xdr::opaque_codec<%s>",
+	       decl->len ? decl->len : "");
+      break;
+
+    case decl_type_simple:
+      gen_cxx_codec (decl->type);
+      break;
+
+    case decl_type_fixed_array:
+      fputs ("portable_xdr::array_codec<", yyout);
+      gen_cxx_codec (decl->type);
+      fputc ('>', yyout);
+      break;
+
+    case decl_type_variable_array:
+      fputs ("portable_xdr::vector_codec<", yyout);
+      gen_cxx_codec (decl->type);
+      if (decl->len)
+	fprintf (yyout, ", %s", decl->len);
+      fputc ('>', yyout);
+      break;
+
+    case decl_type_pointer:
+      fputs ("portable_xdr::optional_codec<", yyout);
+      gen_cxx_codec (decl->type);
+      fputc ('>', yyout);
+      break;
+    }
+}
+
+static void
+gen_cxx_member (int indent, const struct decl *decl, const char *self)
+{
+  spaces (indent);
+  gen_cxx_decl_type (decl, self);
+  fprintf (yyout, " %s{};\n", decl->ident);
+}
+
+static void
+gen_cxx_decl_call (int indent, const struct decl *decl, const char *fn)
+{
+  spaces (indent);
+  fputs ("if (!", yyout);
+  gen_cxx_decl_codec (decl);
+  fprintf (yyout, "::%s (xdrs, obj.%s))\n", fn, decl->ident);
+  spaces (indent+2);
+  fputs ("return false;\n", yyout);
+}
+
+static void
+gen_cxx_namespace_start (void)
+{
+  fprintf (yyout, "namespace %s {\n", cxx_namespace);
+}
+
+static void
+gen_cxx_namespace_end (void)
+{
+  fputs ("}\n\n", yyout);
+}
+
+static void
+gen_cxx_codec_start (const char *name)
+{
+  fprintf (yyout,
+	   "namespace portable_xdr {\n"
+	   "template <>\n"
+	   "struct codec<%s::%s> {\n",
+	   cxx_namespace, name);
+}
+
+static void
+gen_cxx_codec_end (void)
+{
+  fputs ("};\n"
+	 "}\n"
+	 "\n", yyout);
+}
+
+/* The struct or union NAME has been declared in the namespace, which
+ * is still open.  Declare its functions, and give it a codec which
+ * calls them.
+ */
+static void
+gen_cxx_fn_decls (const char *name)
+{
+  fprintf (yyout,
+	   "inline bool encode (XDR *xdrs, const %s &obj);\n"
+	   "inline bool decode (XDR *xdrs, %s &obj);\n",
+	   name, name);
+  gen_cxx_namespace_end ();
+
+  gen_cxx_codec_start (name);
+  fprintf (yyout,
+	   "  static bool encode (XDR *xdrs, const %s::%s &obj)\n"
+	   "  {\n"
+	   "    return %s::encode (xdrs, obj);\n"
+	   "  }\n"
+	   "  static bool decode (XDR *xdrs, %s::%s &obj)\n"
+	   "  {\n"
+	   "    return %s::decode (xdrs, obj);\n"
+	   "  }\n",
+	   cxx_namespace, name, cxx_namespace,
+	   cxx_namespace, name, cxx_namespace);
+  gen_cxx_codec_end ();
+}
+
+static void
+gen_cxx_fn_start (const char *name, const char *fn)
+{
+  fprintf (yyout,
+	   "inline bool\n"
+	   "%s (XDR *xdrs, %s%s &obj)\n"
+	   "{\n",
+	   fn, strcmp (fn, "encode") == 0 ? "const " : "", name);
+}
+
+static void
+gen_cxx_fn_end (void)
+{
+  fputs ("  return true;\n"
+	 "}\n", yyout);
+}
+
+static void
+gen_cxx_prologue (void)
+{
+  set_cxx_namespace ();
+
+  fprintf (yyout, "#ifndef RPCGEN_HEADER_");
+  write_basename_caps ();
+  fprintf (yyout, "_HPP\n#define RPCGEN_HEADER_");
+  write_basename_caps ();
+  fprintf (yyout,
+	   "_HPP\n"
+	   "\n"
+	   "#include <rpc/xdr_codec.hpp>\n"
+	   "\n");
+}
+
+static void
+gen_cxx_epilogue (void)
+{
+  fprintf (yyout, "\n#endif /* RPCGEN_HEADER_");
+  write_basename_caps ();
+  fprintf (yyout, "_HPP */\n");
+}
+
+static void
+gen_cxx_const (const char *name, const char *value)
+{
+  fprintf (yyout,
+	   "#ifndef %s\n"
+	   "#define %s %s\n"
+	   "#endif\n",
+	   name, name, value);
+}
+
+static void
+gen_cxx_enum (const char *name, const struct cons *enum_values)
+{
+  const struct enum_value *ev;
+
+  gen_cxx_namespace_start ();
+  fprintf (yyout, "enum %s : int32_t {\n", name);
+  for (; enum_values; enum_values = enum_values->next) {
+    ev = (const struct enum_value *) enum_values->ptr;
+    if (ev->value)
+      fprintf (yyout, "  %s = %s,\n", ev->ident, ev->value);
+    else
+      fprintf (yyout, "  %s,\n", ev->ident);
+  }
+  fputs ("};\n", yyout);
+  gen_cxx_namespace_end ();
+
+  gen_cxx_codec_start (name);
+  fprintf (yyout,
+	   "  static bool encode (XDR *xdrs, %s::%s obj)\n"
+	   "  {\n"
+	   "    return xdr_encode_enum (xdrs, obj);\n"
+	   "  }\n"
+	   "  static bool decode (XDR *xdrs, %s::%s &obj)\n"
+	   "  {\n"
+	   "    enum_t t;\n"
+	   "    if (!xdr_decode_enum (xdrs, &t))\n"
+	   "      return false;\n"
+	   "    obj = static_cast<%s::%s> (t);\n"
+	   "    return true;\n"
+	   "  }\n",
+	   cxx_namespace, name, cxx_namespace, name, cxx_namespace, name);
+  gen_cxx_codec_end ();
+}
+
+static void
+gen_cxx_struct (const char *name, const struct cons *decls)
+{
+  const struct cons *d;
+  int dir;
+
+  gen_cxx_namespace_start ();
+  fprintf (yyout, "struct %s {\n", name);
+  for (d = decls; d; d = d->next)
+    gen_cxx_member (2, (const struct decl *) d->ptr, name);
+  fputs ("};\n", yyout);
+  gen_cxx_fn_decls (name);
+
+  gen_cxx_namespace_start ();
+  for (dir = dir_encode; dir <= dir_decode; dir++) {
+    if (dir != dir_encode)
+      fputc ('\n', yyout);
+    gen_cxx_fn_start (name, dir_names[dir]);
+    for (d = decls; d; d = d->next)
+      gen_cxx_decl_call (2, (const struct decl *) d->ptr, dir_names[dir]);
+    gen_cxx_fn_end ();
+  }
+  gen_cxx_namespace_end ();
+}
+
+static void
+gen_cxx_union (const char *name, const struct decl *discrim,
+	       const struct cons *union_cases)
+{
+  const struct cons *c;
+  const struct union_case *uc;
+  int dir, has_default;
+
+  gen_cxx_namespace_start ();
+  fprintf (yyout, "struct %s {\n", name);
+  gen_cxx_member (2, discrim, name);
+  for (c = union_cases; c; c = c->next) {
+    uc = (const struct union_case *) c->ptr;
+    if (uc->decl)
+      gen_cxx_member (2, uc->decl, name);
+  }
+  fputs ("};\n", yyout);
+  gen_cxx_fn_decls (name);
+
+  gen_cxx_namespace_start ();
+  for (dir = dir_encode; dir <= dir_decode; dir++) {
+    if (dir != dir_encode)
+      fputc ('\n', yyout);
+    gen_cxx_fn_start (name, dir_names[dir]);
+    gen_cxx_decl_call (2, discrim, dir_names[dir]);
+    fprintf (yyout, "  switch (obj.%s) {\n", discrim->ident);
+    has_default = 0;
+    for (c = union_cases; c; c = c->next) {
+      uc = (const struct union_case *) c->ptr;
+      if (uc->type == union_case_normal)
+	fprintf (yyout, "  case %s:\n", uc->const_);
+      else {
+	fputs ("  default:\n", yyout);
+	has_default = 1;
+      }
+      if (uc->decl)
+	gen_cxx_decl_call (4, uc->decl, dir_names[dir]);
+      fputs ("    break;\n", yyout);
+    }
+    if (!has_default)
+      fputs ("  default:\n"
+	     "    return false;\n", yyout);
+    fputs ("  }\n", yyout);
+    gen_cxx_fn_end ();
+  }
+  gen_cxx_namespace_end ();
+}
+
+static void
+gen_cxx_typedef (const struct decl *decl)
+{
+  char *name;
+
+  gen_cxx_namespace_start ();
+  fprintf (yyout, "using %s = ", decl->ident);
+  gen_cxx_decl_type (decl, NULL);
+  fprintf (yyout, ";\nstruct %s_codec : ", decl->ident);
+  gen_cxx_decl_codec (decl);
+  fputs (" {};\n", yyout);
+  gen_cxx_namespace_end ();
+
+  name = strdup (decl->ident);
+  if (name == NULL)
+    perrorf ("strdup");
+  cxx_typedefs = new_cons (cxx_typedefs, name, free);
+}
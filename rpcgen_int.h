@@ -30,9 +30,20 @@ extern const char *output_filename;
 enum output_mode {
   output_c = 0,
   output_h = 1,
+  output_cxx = 2,		/* C++ header (-x option) */
 };
 extern enum output_mode output_mode;
 
+/* Minimum number of consecutive fixed-size struct fields which are
+ * encoded through one xdr_inline buffer (-i option, 0 = never).
+ */
+extern int inline_threshold;
+
+/* Also generate static inline xdr_NAME_encode, xdr_NAME_decode and
+ * xdr_NAME_free functions in the header file (-e option).
+ */
+extern int direction_functions;
+
 /* Abstract syntax tree types. */
 enum type_enum {
   type_char, type_short, type_int, type_hyper,
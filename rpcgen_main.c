@@ -30,6 +30,8 @@
 #include "rpcgen_int.h"
 
 enum output_mode output_mode;
+int inline_threshold = 5;
+int direction_functions = 0;
 
 static void print_version (void);
 static void usage (const char *progname);
@@ -54,7 +56,7 @@ main (int argc, char *argv[])
    * command line parameters from both GNU rpcgen and BSD rpcgen
    * and print appropriate errors for any we don't understand.
    */
-  while ((opt = getopt (argc, argv, "AD:IK:LMSTVchlmno:s:t")) != -1) {
+  while ((opt = getopt (argc, argv, "AD:IK:LMSTVcehi:lmno:s:tx")) != -1) {
     switch (opt)
       {
 	/*-- Options supported by any rpcgen that we don't support. --*/
@@ -81,14 +83,26 @@ main (int argc, char *argv[])
 	output_modes |= 1 << output_c;
 	break;
 
+      case 'e':
+	direction_functions = 1;
+	break;
+
       case 'h':
 	output_modes |= 1 << output_h;
 	break;
 
+      case 'i':
+	inline_threshold = atoi (optarg);
+	break;
+
       case 'o':
 	out = optarg;
 	break;
 
+      case 'x':
+	output_modes |= 1 << output_cxx;
+	break;
+
 	/* None of the other versions of rpcgen support a way to print
 	 * the version number, which is extremely annoying because
 	 * there are so many different variations of rpcgen around.
@@ -125,6 +139,10 @@ main (int argc, char *argv[])
 	output_mode = output_c;
 	do_rpcgen (filename, out);
       }
+      if ((output_modes & (1 << output_cxx)) != 0) {
+	output_mode = output_cxx;
+	do_rpcgen (filename, out);
+      }
     }
   }
 
@@ -145,15 +163,22 @@ usage (const char *progname)
     ("Generate XDR bindings automatically.\n"
      "\n"
      "Usage:\n"
-     "  portable-rpcgen infile.x\n"
-     "  portable-rpcgen -c|-h [-o outfile] infile.x\n"
+     "  portable-rpcgen [-e] [-i size] infile.x\n"
+     "  portable-rpcgen -c|-h|-x [-e] [-i size] [-o outfile] infile.x\n"
      "  portable-rpcgen -V\n"
      "\n"
      "Options:\n"
      "  -c     Generate C output file only.\n"
+     "  -e     Also generate direction-specific inline functions\n"
+     "         xdr_NAME_encode, xdr_NAME_decode and xdr_NAME_free.\n"
      "  -h     Generate header output file only.\n"
-     "  -o     Name of output file (normally it is 'infile.[ch]').\n"
+     "  -i     Encode runs of at least 'size' fixed-size struct fields\n"
+     "         inline (default 5, 0 to disable).\n"
+     "  -o     Name of output file (normally it is 'infile.[ch]', or\n"
+     "         'infile.hpp' with -x).\n"
      "  -V     Print the version and exit.\n"
+     "  -x     Generate C++ header file with std::string, std::vector\n"
+     "         etc. and portable_xdr::codec serializers.\n"
      "\n"
      "In the first form, without -c or -h, we generate both output files.\n"
      "\n"
@@ -180,6 +205,7 @@ do_rpcgen (const char *filename, const char *out)
   switch (output_mode) {
   case output_c: ext = ".c"; break;
   case output_h: ext = ".h"; break;
+  case output_cxx: ext = ".hpp"; break;
   default: error ("internal error in do_rpcgen / output_mode");
   }
 
@@ -197,7 +223,7 @@ do_rpcgen (const char *filename, const char *out)
   }
   else {
     len = strlen (filename);
-    t = malloc (len + 3);
+    t = malloc (len + strlen (ext) + 1);
     if (t == NULL)
       perrorf ("malloc");
     strcpy (t, filename);
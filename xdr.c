@@ -0,0 +1,444 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Multi-unit gets and puts, opaque data, byte arrays, strings,
+ * unions, references, xdr_free, validation and stream flags.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+/* Generic xdr_getlongs and xdr_putlongs, for streams which don't
+ * have x_getlongs/x_putlongs.  Take as many whole units as the
+ * cursor holds, then let x_getlong/x_putlong move one unit (which
+ * refills or drains the cursor), and repeat.
+ */
+bool_t
+xdr__getlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  size_t i, k;
+
+  while (n > 0) {
+    if (xdrs->x_op != XDR_ENCODE) {
+      k = (xdrs->x__end - xdrs->x__cur) / BYTES_PER_XDR_UNIT;
+      if (k > n)
+	k = n;
+      for (i = 0; i < k; ++i)
+	v[i] = (int32_t) xdr__load32 (xdrs->x__cur + i * BYTES_PER_XDR_UNIT);
+      xdrs->x__cur += k * BYTES_PER_XDR_UNIT;
+      v += k;
+      n -= k;
+      if (n == 0)
+	break;
+    }
+    if (!xdrs->x_ops->x_getlong (xdrs, v))
+      return FALSE;
+    v++;
+    n--;
+  }
+  return TRUE;
+}
+
+bool_t
+xdr__putlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  size_t i, k;
+
+  while (n > 0) {
+    if (xdrs->x_op == XDR_ENCODE) {
+      k = (xdrs->x__end - xdrs->x__cur) / BYTES_PER_XDR_UNIT;
+      if (k > n)
+	k = n;
+      for (i = 0; i < k; ++i)
+	xdr__store32 (xdrs->x__cur + i * BYTES_PER_XDR_UNIT, (uint32_t) v[i]);
+      xdrs->x__cur += k * BYTES_PER_XDR_UNIT;
+      v += k;
+      n -= k;
+      if (n == 0)
+	break;
+    }
+    if (!xdrs->x_ops->x_putlong (xdrs, v))
+      return FALSE;
+    v++;
+    n--;
+  }
+  return TRUE;
+}
+
+/* Padding is always written as zeroes.  When decoding we don't
+ * check it.
+ */
+static char xdr_zero[BYTES_PER_XDR_UNIT] = { 0, 0, 0, 0 };
+
+bool_t
+xdr_opaque (XDR *xdrs, void *p, size_t num_bytes)
+{
+  char crud[BYTES_PER_XDR_UNIT];
+  size_t pad = RNDUP (num_bytes) - num_bytes;
+  size_t avail;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      if (xdr__counting (xdrs)) {
+	xdr__sizeof_add (xdrs, num_bytes + pad);
+	return TRUE;
+      }
+      /* The data and its padding in one piece, if the cursor has
+       * room for both and the stream doesn't want to see payloads.
+       */
+      avail = xdrs->x__end - xdrs->x__cur;
+      if (!(xdrs->x__flags & XDR__REFERENCE) &&
+	  num_bytes <= avail && pad <= avail - num_bytes) {
+	if (num_bytes > 0)
+	  memcpy (xdrs->x__cur, p, num_bytes);
+	if (pad > 0)
+	  memset (xdrs->x__cur + num_bytes, 0, pad);
+	xdrs->x__cur += num_bytes + pad;
+	return TRUE;
+      }
+      if (num_bytes > 0 && !xdr_putbytes (xdrs, p, num_bytes))
+	return FALSE;
+      return pad == 0 || xdr_putbytes (xdrs, xdr_zero, pad);
+    case XDR_DECODE:
+      if (xdr__validating (xdrs))
+	return xdr__skip (xdrs, num_bytes);
+      avail = xdrs->x__end - xdrs->x__cur;
+      if (num_bytes <= avail && pad <= avail - num_bytes) {
+	if (num_bytes > 0)
+	  memcpy (p, xdrs->x__cur, num_bytes);
+	xdrs->x__cur += num_bytes + pad;
+	return TRUE;
+      }
+      if (num_bytes > 0 && !xdr_getbytes (xdrs, p, num_bytes))
+	return FALSE;
+      return pad == 0 || xdr_getbytes (xdrs, crud, pad);
+    case XDR_FREE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+bool_t
+xdr_bytes (XDR *xdrs, char **bytes, uint32_t *num_bytes, size_t max_bytes)
+{
+  char *p = *bytes;
+  uint32_t old_len = *num_bytes;
+  uint32_t len;
+
+  /* When sizing, the length word and payload are simply counted. */
+  if (xdr__counting (xdrs)) {
+    if (*num_bytes > max_bytes)
+      return FALSE;
+    xdr__sizeof_add (xdrs, BYTES_PER_XDR_UNIT + RNDUP ((size_t) *num_bytes));
+    return TRUE;
+  }
+
+  if (!xdr_uint32_t (xdrs, num_bytes))
+    return FALSE;
+  len = *num_bytes;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_DECODE:
+      if (len > max_bytes)
+	return FALSE;
+      if (xdr__validating (xdrs))
+	return xdr__skip (xdrs, len);
+      if (len == 0)
+	return TRUE;
+      /* As in SunRPC, decode into the caller's buffer if they
+       * supplied one.  In XDR_DECODE_REUSE mode it is a buffer from
+       * an earlier decode, which we may have to grow.
+       */
+      if (p != NULL && xdr__reusing (xdrs)) {
+	p = xdr__reuse (p, old_len, len);
+	if (p == NULL)
+	  return FALSE;
+	*bytes = p;
+      }
+      if (p == NULL) {
+	if (xdr__borrowing (xdrs)) {
+	  p = xdr_inline (xdrs, RNDUP ((size_t) len));
+	  if (p) {
+	    *bytes = p;
+	    return TRUE;
+	  }
+	}
+	p = xdr__alloc (xdrs, len);
+	if (p == NULL)
+	  return FALSE;
+	*bytes = p;
+      }
+      return xdr_opaque (xdrs, p, len);
+    case XDR_ENCODE:
+      if (len > max_bytes)
+	return FALSE;
+      return xdr_opaque (xdrs, p, len);
+    case XDR_FREE:
+      xdr__free (xdrs, p);
+      *bytes = NULL;
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+bool_t
+xdr_string (XDR *xdrs, char **str, size_t max_bytes)
+{
+  char *p = *str;
+  uint32_t len = 0;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_FREE:
+      xdr__free (xdrs, p);
+      *str = NULL;
+      return TRUE;
+    case XDR_ENCODE:
+      if (p == NULL)
+	return FALSE;
+      len = strlen (p);
+      if (xdr__counting (xdrs)) {
+	if (len > max_bytes)
+	  return FALSE;
+	xdr__sizeof_add (xdrs, BYTES_PER_XDR_UNIT + RNDUP ((size_t) len));
+	return TRUE;
+      }
+      break;
+    default:
+      break;
+    }
+
+  if (!xdr_uint32_t (xdrs, &len))
+    return FALSE;
+  if (len > max_bytes)
+    return FALSE;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_DECODE:
+      if (xdr__validating (xdrs))
+	return xdr__skip (xdrs, len);
+      if (p != NULL && xdr__reusing (xdrs)) {
+	p = xdr__reuse (p, strlen (p) + 1, (size_t) len + 1);
+	if (p == NULL)
+	  return FALSE;
+	*str = p;
+      }
+      if (p == NULL) {
+	/* A borrowed string can be terminated in place if there is a
+	 * padding byte after it.
+	 */
+	if (xdr__borrowing (xdrs) && (xdrs->x__flags & XDR__WRITABLE) &&
+	    len % BYTES_PER_XDR_UNIT != 0) {
+	  p = xdr_inline (xdrs, RNDUP ((size_t) len));
+	  if (p) {
+	    p[len] = '\0';
+	    *str = p;
+	    return TRUE;
+	  }
+	}
+	if ((size_t) len + 1 == 0)
+	  return FALSE;
+	p = xdr__alloc (xdrs, (size_t) len + 1);
+	if (p == NULL)
+	  return FALSE;
+	*str = p;
+      }
+      p[len] = '\0';
+      return xdr_opaque (xdrs, p, len);
+    case XDR_ENCODE:
+      return xdr_opaque (xdrs, p, len);
+    default:
+      return FALSE;
+    }
+}
+
+bool_t
+xdr_wrapstring (XDR *xdrs, char **str)
+{
+  return xdr_string (xdrs, str, ~(size_t) 0);
+}
+
+bool_t
+xdr_union (XDR *xdrs, enum_t *discrim, void *p,
+	   struct xdr_discrim *choices, xdrproc_t default_proc)
+{
+  if (!xdr_enum (xdrs, discrim))
+    return FALSE;
+
+  for (; choices->proc != NULL_xdrproc_t; choices++)
+    if (choices->value == *discrim)
+      return choices->proc (xdrs, p);
+
+  if (default_proc == NULL_xdrproc_t)
+    return FALSE;
+  return default_proc (xdrs, p);
+}
+
+bool_t
+xdr_reference (XDR *xdrs, char **p, size_t size, xdrproc_t proc)
+{
+  char *obj = *p;
+  bool_t r;
+
+  if (xdrs->x_op == XDR_DECODE && xdr__validating (xdrs))
+    return xdr__validate_elements (xdrs, 1, size, proc);
+
+  if (obj == NULL) {
+    switch (xdrs->x_op)
+      {
+      case XDR_DECODE:
+	obj = xdr__calloc (xdrs, 1, size);
+	if (obj == NULL)
+	  return FALSE;
+	*p = obj;
+	break;
+      case XDR_FREE:
+	return TRUE;
+      default:
+	return FALSE;
+      }
+  }
+
+  r = proc (xdrs, obj);
+
+  if (xdrs->x_op == XDR_FREE) {
+    free (obj);
+    *p = NULL;
+  }
+  return r;
+}
+
+bool_t
+xdr_pointer (XDR *xdrs, char **p, size_t size, xdrproc_t proc)
+{
+  bool_t not_null = *p != NULL;
+
+  if (!xdr_bool (xdrs, &not_null))
+    return FALSE;
+  if (!not_null) {
+    if (xdrs->x_op == XDR_DECODE) {
+      /* Don't leak an object left by an earlier decode. */
+      if (*p != NULL && xdr__reusing (xdrs)) {
+	xdr_free (proc, *p);
+	free (*p);
+      }
+      *p = NULL;
+    }
+    return TRUE;
+  }
+  return xdr_reference (xdrs, p, size, proc);
+}
+
+void
+xdr_free (xdrproc_t proc, void *p)
+{
+  XDR x;
+
+  memset (&x, 0, sizeof x);
+  x.x_op = XDR_FREE;
+  proc (&x, p);
+}
+
+bool_t
+xdr__skip (XDR *xdrs, size_t len)
+{
+  size_t avail = xdrs->x__end - xdrs->x__cur;
+  size_t pad;
+
+  if (len > avail)
+    return FALSE;
+  pad = (BYTES_PER_XDR_UNIT - len % BYTES_PER_XDR_UNIT) % BYTES_PER_XDR_UNIT;
+  if (pad > avail - len || memcmp (xdrs->x__cur + len, xdr_zero, pad) != 0)
+    return FALSE;
+  xdrs->x__cur += len + pad;
+  return TRUE;
+}
+
+bool_t
+xdr_validate (xdrproc_t proc, void *obj, const void *buf, size_t len)
+{
+  XDR x;
+
+  xdrmem_create (&x, (void *) buf, len, XDR_DECODE);
+  x.x__flags = XDR__VALIDATE;
+  return proc (&x, obj) && x.x__cur == x.x__end;
+}
+
+/* The segments passed to xdr_free_borrowed. */
+struct borrowed {
+  const struct iovec *iov;
+  int iovcnt;
+};
+
+void
+xdr__free (XDR *xdrs, void *p)
+{
+  const struct borrowed *b;
+  const char *base;
+  int i;
+
+  if (xdrs->x__flags & XDR__BORROWED) {
+    b = xdrs->x__private;
+    for (i = 0; i < b->iovcnt; ++i) {
+      base = b->iov[i].iov_base;
+      if ((const char *) p >= base && (const char *) p < base + b->iov[i].iov_len)
+	return;
+    }
+  }
+  free (p);
+}
+
+void
+xdr_free_borrowed (xdrproc_t proc, void *p,
+		   const struct iovec *iov, int iovcnt)
+{
+  struct borrowed b;
+  XDR x;
+
+  b.iov = iov;
+  b.iovcnt = iovcnt;
+  memset (&x, 0, sizeof x);
+  x.x_op = XDR_FREE;
+  x.x__private = &b;
+  x.x__flags = XDR__BORROWED;
+  proc (&x, p);
+}
+
+void
+xdr_setflags (XDR *xdrs, unsigned int flags)
+{
+  xdrs->x__flags = (xdrs->x__flags & XDR__PRIVATE) | (flags & ~XDR__PRIVATE);
+}
+
+unsigned int
+xdr_getflags (XDR *xdrs)
+{
+  return xdrs->x__flags & ~XDR__PRIVATE;
+}
@@ -0,0 +1,223 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Arenas for decoded data.
+ *
+ * Memory is handed out by bumping a pointer through a list of
+ * chunks.  Resetting the arena just moves back to the first chunk,
+ * so the chunks are reused by the next message and the steady state
+ * makes no calls to malloc at all.  Allocations too big to share a
+ * chunk get one to themselves, and those are freed on reset.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+#define XDR_ARENA_DEFAULT_CHUNK_SIZE 65536
+
+/* Everything handed out is aligned for any of these. */
+union align {
+  long double ld;
+  double d;
+  int64_t i;
+  void *p;
+  void (*f) (void);
+};
+
+#define ALIGNMENT (sizeof (union align))
+
+struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size;			/* usable bytes in data */
+  union align data[];
+};
+
+struct xdr_arena {
+  size_t chunk_size;
+  struct arena_chunk *first;	/* chunks, kept across resets */
+  struct arena_chunk *cur;	/* chunk being allocated from */
+  char *p, *end;		/* free space in cur */
+  struct arena_chunk *large;	/* oversized allocations */
+};
+
+static struct arena_chunk *
+new_chunk (size_t size)
+{
+  struct arena_chunk *c;
+
+  if (size > SIZE_MAX - sizeof *c)
+    return NULL;
+  c = malloc (sizeof *c + size);
+  if (c == NULL)
+    return NULL;
+  c->next = NULL;
+  c->size = size;
+  return c;
+}
+
+static void
+free_chunks (struct arena_chunk *c)
+{
+  struct arena_chunk *next;
+
+  for (; c != NULL; c = next) {
+    next = c->next;
+    free (c);
+  }
+}
+
+static void
+set_chunk (struct xdr_arena *a, struct arena_chunk *c)
+{
+  a->cur = c;
+  a->p = (char *) c->data;
+  a->end = a->p + c->size;
+}
+
+struct xdr_arena *
+xdr_arena_create (size_t chunk_size)
+{
+  struct xdr_arena *a;
+
+  if (chunk_size == 0)
+    chunk_size = XDR_ARENA_DEFAULT_CHUNK_SIZE;
+
+  a = malloc (sizeof *a);
+  if (a == NULL)
+    return NULL;
+  a->chunk_size = chunk_size;
+  a->large = NULL;
+  a->first = new_chunk (chunk_size);
+  if (a->first == NULL) {
+    free (a);
+    return NULL;
+  }
+  set_chunk (a, a->first);
+  return a;
+}
+
+void *
+xdr_arena_alloc (struct xdr_arena *a, size_t size)
+{
+  struct arena_chunk *c;
+  void *r;
+
+  if (size > SIZE_MAX - ALIGNMENT)
+    return NULL;
+  size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+  if ((size_t) (a->end - a->p) < size) {
+    /* Give anything larger than a quarter chunk its own block, so
+     * that it doesn't waste the rest of the current chunk.
+     */
+    if (size > a->chunk_size / 4) {
+      c = new_chunk (size);
+      if (c == NULL)
+	return NULL;
+      c->next = a->large;
+      a->large = c;
+      return c->data;
+    }
+
+    /* Move on to the next chunk, reusing one left over from before
+     * the last reset if there is one.
+     */
+    c = a->cur->next;
+    if (c == NULL) {
+      c = new_chunk (a->chunk_size);
+      if (c == NULL)
+	return NULL;
+      a->cur->next = c;
+    }
+    set_chunk (a, c);
+  }
+
+  r = a->p;
+  a->p += size;
+  return r;
+}
+
+void
+xdr_arena_reset (struct xdr_arena *a)
+{
+  free_chunks (a->large);
+  a->large = NULL;
+  set_chunk (a, a->first);
+}
+
+void
+xdr_arena_destroy (struct xdr_arena *a)
+{
+  if (a == NULL)
+    return;
+  free_chunks (a->large);
+  free_chunks (a->first);
+  free (a);
+}
+
+void
+xdr_setarena (XDR *xdrs, struct xdr_arena *a)
+{
+  xdrs->x__arena = a;
+}
+
+void *
+xdr__alloc (XDR *xdrs, size_t size)
+{
+  if (xdrs->x__arena)
+    return xdr_arena_alloc (xdrs->x__arena, size);
+  return malloc (size);
+}
+
+void *
+xdr__calloc (XDR *xdrs, size_t n, size_t size)
+{
+  void *p;
+
+  if (xdrs->x__arena == NULL)
+    return calloc (n, size);
+
+  if (size > 0 && n > SIZE_MAX / size)
+    return NULL;
+  p = xdr_arena_alloc (xdrs->x__arena, n * size);
+  if (p)
+    memset (p, 0, n * size);
+  return p;
+}
+
+void *
+xdr__reuse (void *p, size_t known, size_t size)
+{
+#ifdef HAVE_MALLOC_USABLE_SIZE
+  known = malloc_usable_size (p);
+#endif
+  if (size <= known)
+    return p;
+  return realloc (p, size);
+}
@@ -0,0 +1,462 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Variable and fixed size arrays.
+ *
+ * Arrays of 32 and 64 bit integers and floating point numbers are
+ * very common and calling the element function once per element is
+ * slow, so we recognise those element functions and convert the
+ * whole array in one go.  Arrays of 8 and 16 bit integers take one
+ * unit per element, and are moved in blocks with xdr_getlongs and
+ * xdr_putlongs.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+/* Size of the buffer used to widen or narrow 8 and 16 bit integers. */
+#define BOUNCE_UNITS 512
+
+/* If the element function simply byte swaps a 32 or 64 bit
+ * quantity, return its size, otherwise 0.
+ */
+static size_t
+unit_size_of_proc (xdrproc_t proc)
+{
+  if (proc == (xdrproc_t) xdr_int32_t || proc == (xdrproc_t) xdr_uint32_t ||
+      proc == (xdrproc_t) xdr_float)
+    return 4;
+  if (proc == (xdrproc_t) xdr_int64_t || proc == (xdrproc_t) xdr_uint64_t ||
+      proc == (xdrproc_t) xdr_double)
+    return 8;
+  return 0;
+}
+
+static void
+swap_units (void *dest, const void *src, size_t n, size_t unit_size)
+{
+  if (unit_size == 4)
+    xdr__swap32 (dest, src, n);
+  else
+    xdr__swap64 (dest, src, n);
+}
+
+/* Put one unit with x_putlong, for when it doesn't fit in the
+ * stream's buffer.
+ */
+static bool_t
+put_unit (XDR *xdrs, const void *src, size_t unit_size)
+{
+  uint64_t v64;
+  uint32_t v32;
+  int32_t l;
+
+  if (unit_size == 4) {
+    memcpy (&v32, src, 4);
+    l = (int32_t) v32;
+    return xdr_putlong (xdrs, &l);
+  }
+  memcpy (&v64, src, 8);
+  l = (int32_t) (uint32_t) (v64 >> 32);
+  if (!xdr_putlong (xdrs, &l))
+    return FALSE;
+  l = (int32_t) (uint32_t) v64;
+  return xdr_putlong (xdrs, &l);
+}
+
+bool_t
+xdr__vector_units (XDR *xdrs, void *p, size_t n, size_t unit_size)
+{
+  size_t len = n * unit_size, chunk;
+  char *src = p;
+  void *buf;
+
+  if (n > SIZE_MAX / unit_size)
+    return FALSE;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      if (xdr__counting (xdrs)) {
+	xdr__sizeof_add (xdrs, len);
+	return TRUE;
+      }
+      buf = xdr_inline (xdrs, len);
+      if (buf) {
+	swap_units (buf, p, n, unit_size);
+	return TRUE;
+      }
+      if (unit_size == 4 && xdrs->x_ops->x_putlongs)
+	return xdr_putlongs (xdrs, p, n);
+      /* Convert straight into the stream's buffer as far as it
+       * goes, and put the unit which doesn't fit on its own, which
+       * usually gives us a fresh buffer.  Converting into a scratch
+       * buffer and calling xdr_putbytes would be wrong: a chunk
+       * stream may keep a reference to the bytes instead of copying
+       * them.
+       */
+      while (n > 0) {
+	chunk = (xdrs->x__end - xdrs->x__cur) / unit_size;
+	if (chunk > n)
+	  chunk = n;
+	swap_units (xdrs->x__cur, src, chunk, unit_size);
+	xdrs->x__cur += chunk * unit_size;
+	src += chunk * unit_size;
+	n -= chunk;
+	if (n > 0) {
+	  if (!put_unit (xdrs, src, unit_size))
+	    return FALSE;
+	  src += unit_size;
+	  n--;
+	}
+      }
+      return TRUE;
+
+    case XDR_DECODE:
+      if (xdr__validating (xdrs))
+	return xdr__skip (xdrs, len);
+      /* Either convert straight out of the stream, or read the raw
+       * bytes into place and convert them there.
+       */
+      buf = xdr_inline (xdrs, len);
+      if (buf == NULL) {
+	if (unit_size == 4 && xdrs->x_ops->x_getlongs)
+	  return xdr_getlongs (xdrs, p, n);
+	if (!xdr_getbytes (xdrs, p, len))
+	  return FALSE;
+	buf = p;
+      }
+      swap_units (p, buf, n, unit_size);
+      return TRUE;
+
+    case XDR_FREE:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* Element functions for narrow integers, and the element size each
+ * one expects.
+ */
+static size_t
+narrow_size_of_proc (xdrproc_t proc)
+{
+  if (proc == (xdrproc_t) xdr_int16_t || proc == (xdrproc_t) xdr_uint16_t)
+    return 2;
+  if (proc == (xdrproc_t) xdr_int8_t || proc == (xdrproc_t) xdr_uint8_t)
+    return 1;
+  return 0;
+}
+
+static bool_t
+vector_narrow (XDR *xdrs, void *p, size_t n, xdrproc_t proc)
+{
+  int32_t buf[BOUNCE_UNITS];
+  size_t chunk, i;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      if (xdr__counting (xdrs)) {
+	if (n > SIZE_MAX / BYTES_PER_XDR_UNIT)
+	  return FALSE;
+	xdr__sizeof_add (xdrs, n * BYTES_PER_XDR_UNIT);
+	return TRUE;
+      }
+      break;
+    case XDR_DECODE:
+      if (xdr__validating (xdrs)) {
+	if (n > SIZE_MAX / BYTES_PER_XDR_UNIT)
+	  return FALSE;
+	return xdr__skip (xdrs, n * BYTES_PER_XDR_UNIT);
+      }
+      break;
+    case XDR_FREE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+
+  for (; n > 0; n -= chunk) {
+    chunk = n < BOUNCE_UNITS ? n : BOUNCE_UNITS;
+
+    if (xdrs->x_op == XDR_ENCODE) {
+      if (proc == (xdrproc_t) xdr_int16_t)
+	for (i = 0; i < chunk; ++i)
+	  buf[i] = ((int16_t *) p)[i];
+      else if (proc == (xdrproc_t) xdr_uint16_t)
+	for (i = 0; i < chunk; ++i)
+	  buf[i] = ((uint16_t *) p)[i];
+      else if (proc == (xdrproc_t) xdr_int8_t)
+	for (i = 0; i < chunk; ++i)
+	  buf[i] = ((int8_t *) p)[i];
+      else
+	for (i = 0; i < chunk; ++i)
+	  buf[i] = ((uint8_t *) p)[i];
+      if (!xdr_putlongs (xdrs, buf, chunk))
+	return FALSE;
+    }
+    else {
+      if (!xdr_getlongs (xdrs, buf, chunk))
+	return FALSE;
+      if (proc == (xdrproc_t) xdr_int16_t)
+	for (i = 0; i < chunk; ++i)
+	  ((int16_t *) p)[i] = (int16_t) buf[i];
+      else if (proc == (xdrproc_t) xdr_uint16_t)
+	for (i = 0; i < chunk; ++i)
+	  ((uint16_t *) p)[i] = (uint16_t) buf[i];
+      else if (proc == (xdrproc_t) xdr_int8_t)
+	for (i = 0; i < chunk; ++i)
+	  ((int8_t *) p)[i] = (int8_t) buf[i];
+      else
+	for (i = 0; i < chunk; ++i)
+	  ((uint8_t *) p)[i] = (uint8_t) buf[i];
+    }
+    p = (char *) p + chunk * narrow_size_of_proc (proc);
+  }
+  return TRUE;
+}
+
+bool_t
+xdr_vector (XDR *xdrs, void *p, size_t num_elements, size_t element_size,
+	    xdrproc_t element_proc)
+{
+  size_t unit_size = unit_size_of_proc (element_proc);
+  char *elem = p;
+  size_t i;
+
+  if (unit_size > 0 && unit_size == element_size)
+    return xdr__vector_units (xdrs, p, num_elements, unit_size);
+  if (narrow_size_of_proc (element_proc) == element_size && element_size > 0)
+    return vector_narrow (xdrs, p, num_elements, element_proc);
+
+  for (i = 0; i < num_elements; ++i) {
+    if (!element_proc (xdrs, elem))
+      return FALSE;
+    elem += element_size;
+  }
+  return TRUE;
+}
+
+/* Fixed-size arrays of the basic types.  These do what xdr_vector
+ * does for the element functions it recognises, without having to
+ * recognise them.
+ */
+bool_t
+xdr_vector_int32 (XDR *xdrs, int32_t *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 4);
+}
+
+bool_t
+xdr_vector_uint32 (XDR *xdrs, uint32_t *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 4);
+}
+
+bool_t
+xdr_vector_int64 (XDR *xdrs, int64_t *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 8);
+}
+
+bool_t
+xdr_vector_uint64 (XDR *xdrs, uint64_t *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 8);
+}
+
+bool_t
+xdr_vector_float (XDR *xdrs, float *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 4);
+}
+
+bool_t
+xdr_vector_double (XDR *xdrs, double *p, size_t n)
+{
+  return xdr__vector_units (xdrs, p, n, 8);
+}
+
+bool_t
+xdr_vector_int16 (XDR *xdrs, int16_t *p, size_t n)
+{
+  return vector_narrow (xdrs, p, n, (xdrproc_t) xdr_int16_t);
+}
+
+bool_t
+xdr_vector_uint16 (XDR *xdrs, uint16_t *p, size_t n)
+{
+  return vector_narrow (xdrs, p, n, (xdrproc_t) xdr_uint16_t);
+}
+
+bool_t
+xdr_vector_int8 (XDR *xdrs, int8_t *p, size_t n)
+{
+  return vector_narrow (xdrs, p, n, (xdrproc_t) xdr_int8_t);
+}
+
+bool_t
+xdr_vector_uint8 (XDR *xdrs, uint8_t *p, size_t n)
+{
+  return vector_narrow (xdrs, p, n, (xdrproc_t) xdr_uint8_t);
+}
+
+/* Space for one element when validating, so that it doesn't have to
+ * be allocated.  Larger elements are rare, and their size is fixed
+ * by the type, not by the input.
+ */
+#define SCRATCH_SIZE 256
+
+bool_t
+xdr__validate_elements (XDR *xdrs, size_t n, size_t element_size,
+			xdrproc_t element_proc)
+{
+  union {
+    char c[SCRATCH_SIZE];
+    long double ld;
+    int64_t i;
+    void *p;
+  } scratch;
+  void *elem = &scratch;
+  bool_t r = TRUE;
+  size_t i;
+
+  if (element_size > sizeof scratch) {
+    elem = malloc (element_size);
+    if (elem == NULL)
+      return FALSE;
+  }
+  memset (elem, 0, element_size);
+
+  for (i = 0; r && i < n; ++i)
+    r = element_proc (xdrs, elem);
+
+  if (elem != &scratch)
+    free (elem);
+  return r;
+}
+
+/* Make an array left by an earlier decode (see XDR_DECODE_REUSE)
+ * ready to receive n elements, when it held old_n.
+ */
+static bool_t
+reuse_array (char **p, uint32_t old_n, uint32_t n, size_t element_size,
+	     xdrproc_t element_proc, bool_t flat)
+{
+  char *array = *p;
+  size_t i;
+
+  if (!flat)
+    for (i = n; i < old_n; ++i)
+      xdr_free (element_proc, array + i * element_size);
+
+  array = xdr__reuse (array, (size_t) old_n * element_size, n * element_size);
+  if (array == NULL)
+    return FALSE;
+  *p = array;
+
+  /* New elements must start out empty, like those from calloc. */
+  if (!flat && n > old_n)
+    memset (array + (size_t) old_n * element_size, 0,
+	    (size_t) (n - old_n) * element_size);
+  return TRUE;
+}
+
+bool_t
+xdr_array (XDR *xdrs, char **p, uint32_t *num_elements, size_t max_elements,
+	   size_t element_size, xdrproc_t element_proc)
+{
+  /* Integer elements can't contain pointers, so they needn't be
+   * zeroed before decoding or visited when freeing.
+   */
+  bool_t flat = unit_size_of_proc (element_proc) > 0 ||
+    narrow_size_of_proc (element_proc) > 0;
+  char *array = *p;
+  uint32_t old_n = *num_elements;
+  uint32_t n;
+  bool_t r;
+
+  if (!xdr_uint32_t (xdrs, num_elements))
+    return FALSE;
+  n = *num_elements;
+
+  if (xdrs->x_op != XDR_FREE &&
+      (n > max_elements || (element_size > 0 && n > SIZE_MAX / element_size)))
+    return FALSE;
+
+  /* Every element takes at least one unit, so a count which is
+   * bigger than the rest of the input can be rejected at once.
+   */
+  if (xdrs->x_op == XDR_DECODE && xdr__validating (xdrs)) {
+    if (n > (size_t) (xdrs->x__end - xdrs->x__cur) / BYTES_PER_XDR_UNIT)
+      return FALSE;
+    if (element_size > 0 &&
+	(unit_size_of_proc (element_proc) == element_size ||
+	 narrow_size_of_proc (element_proc) == element_size))
+      return xdr_vector (xdrs, NULL, n, element_size, element_proc);
+    return xdr__validate_elements (xdrs, n, element_size, element_proc);
+  }
+
+  if (array != NULL && xdrs->x_op == XDR_DECODE && xdr__reusing (xdrs)) {
+    if (!reuse_array (p, old_n, n, element_size, element_proc, flat))
+      return FALSE;
+    array = *p;
+  }
+
+  if (array == NULL) {
+    switch (xdrs->x_op)
+      {
+      case XDR_DECODE:
+	if (n == 0)
+	  return TRUE;
+	if (flat)
+	  array = xdr__alloc (xdrs, n * element_size);
+	else
+	  array = xdr__calloc (xdrs, n, element_size);
+	if (array == NULL)
+	  return FALSE;
+	*p = array;
+	break;
+      case XDR_FREE:
+	return TRUE;
+      default:
+	break;
+      }
+  }
+
+  if (flat && xdrs->x_op == XDR_FREE)
+    r = TRUE;
+  else
+    r = xdr_vector (xdrs, array, n, element_size, element_proc);
+
+  if (xdrs->x_op == XDR_FREE) {
+    free (array);
+    *p = NULL;
+  }
+  return r;
+}
@@ -0,0 +1,479 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Growable encode streams, created by xdrchunk_create.
+ *
+ * The encoded data is kept in a list of fixed-size chunks.  When the
+ * current chunk fills up we link a new one on the end, so nothing is
+ * ever reallocated or copied while encoding.  The cursor fields in
+ * the XDR handle always describe the current chunk.
+ *
+ * If the stream was created by xdrchunk_create2 with a reference
+ * threshold, then payloads of at least that many bytes are not
+ * copied at all.  Instead we link in a read-only chunk which points
+ * at the caller's memory, and carry on encoding into the unused tail
+ * of the previous chunk.
+ *
+ * Every chunk's size field is the number of bytes of data in it,
+ * except for the last chunk where the amount used is tracked by the
+ * length field of the stream.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#define XDRCHUNK_DEFAULT_SIZE 8192
+
+struct chunk {
+  struct chunk *next;
+  char *data;
+  size_t size;			/* bytes of data (see above) */
+  size_t alloc;			/* capacity, 0 if read-only */
+  char buf[];
+};
+
+struct xdrchunk {
+  size_t chunk_size;		/* size of new chunks */
+  size_t threshold;		/* reference payloads this big, 0 = never */
+  struct chunk *first;
+  struct chunk *cur;		/* chunk containing the cursor */
+  off_t cur_offset;		/* stream offset of cur->data[0] */
+  off_t length;			/* high-water mark (see sync_length) */
+  struct iovec *iov;		/* returned by xdrchunk_getiov */
+  int iov_alloc;
+  char *linear;			/* returned by xdrchunk_linearize */
+};
+
+#define XDRCHUNK(xdrs) ((struct xdrchunk *) (xdrs)->x__private)
+
+/* Puts into the current chunk don't update the length, so do that
+ * whenever we are about to leave the chunk or report the length.
+ */
+static void
+sync_length (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  off_t pos = c->cur_offset + (xdrs->x__cur - xdrs->x__base);
+
+  if (pos > c->length)
+    c->length = pos;
+}
+
+/* The last chunk can be written up to its capacity, others only
+ * up to the data already in them.
+ */
+static void
+set_window (XDR *xdrs, struct chunk *ch, off_t offset, size_t used)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+
+  c->cur = ch;
+  c->cur_offset = offset;
+  xdrs->x__base = ch->data;
+  xdrs->x__cur = ch->data + used;
+  xdrs->x__end = ch->data + (ch->next ? ch->size : ch->alloc);
+}
+
+static struct chunk *
+new_chunk (struct chunk *prev, char *data, size_t alloc, size_t buf_size)
+{
+  struct chunk *ch = malloc (sizeof *ch + buf_size);
+
+  if (ch == NULL)
+    return NULL;
+  ch->next = NULL;
+  ch->data = data ? data : ch->buf;
+  ch->size = 0;
+  ch->alloc = alloc;
+  prev->next = ch;
+  return ch;
+}
+
+/* The current chunk is about to stop being the last one, so record
+ * how much data it holds.
+ */
+static void
+close_chunk (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+
+  sync_length (xdrs);
+  if (c->cur->next == NULL)
+    c->cur->size = c->length - c->cur_offset;
+}
+
+/* Move the cursor to the start of the following chunk, allocating
+ * it if necessary.  Only called when the current chunk is full.
+ */
+static bool_t
+next_chunk (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *ch = c->cur->next;
+
+  close_chunk (xdrs);
+
+  if (ch == NULL) {
+    ch = new_chunk (c->cur, NULL, c->chunk_size, c->chunk_size);
+    if (ch == NULL)
+      return FALSE;
+  }
+  else if (ch->alloc == 0)	/* Don't overwrite a reference. */
+    return FALSE;
+
+  set_window (xdrs, ch, c->cur_offset + c->cur->size, 0);
+  return TRUE;
+}
+
+/* Append a reference to the caller's memory, followed by a chunk for
+ * subsequent data which reuses any space left in the current chunk.
+ */
+static bool_t
+put_reference (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *cur = c->cur, *ref, *tail;
+  size_t used;
+
+  close_chunk (xdrs);
+  used = cur->size;
+
+  ref = new_chunk (cur, p, 0, 0);
+  if (ref == NULL)
+    return FALSE;
+  ref->size = len;
+
+  if (cur->alloc - used >= BYTES_PER_XDR_UNIT)
+    tail = new_chunk (ref, cur->data + used, cur->alloc - used, 0);
+  else
+    tail = new_chunk (ref, NULL, c->chunk_size, c->chunk_size);
+  if (tail == NULL) {
+    cur->next = NULL;
+    free (ref);
+    return FALSE;
+  }
+  cur->alloc = used;
+
+  c->length += len;
+  set_window (xdrs, tail, c->cur_offset + used + len, 0);
+  return TRUE;
+}
+static bool_t
+xdrchunk_getlong (XDR *xdrs ATTRIBUTE_UNUSED, int32_t *v ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static bool_t
+xdrchunk_getbytes (XDR *xdrs ATTRIBUTE_UNUSED, void *p ATTRIBUTE_UNUSED,
+		   size_t len ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+/* Copy bytes into the chunks.  Used directly for our own scratch
+ * buffers, which must never be referenced.
+ */
+static bool_t
+put_copy (XDR *xdrs, const void *p, size_t len)
+{
+  const char *src = p;
+  size_t n;
+
+  while (len > 0) {
+    if (xdrs->x__cur == xdrs->x__end && !next_chunk (xdrs))
+      return FALSE;
+    n = xdrs->x__end - xdrs->x__cur;
+    if (n > len)
+      n = len;
+    memcpy (xdrs->x__cur, src, n);
+    xdrs->x__cur += n;
+    src += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static off_t xdrchunk_getpostn (XDR *xdrs);
+
+static bool_t
+xdrchunk_putbytes (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+
+  if (c == NULL)
+    return FALSE;
+
+  /* Payloads are only referenced when appending. */
+  if (c->threshold > 0 && len >= c->threshold && c->cur->next == NULL &&
+      xdrchunk_getpostn (xdrs) >= c->length)
+    return put_reference (xdrs, p, len);
+
+  return put_copy (xdrs, p, len);
+}
+
+static bool_t
+xdrchunk_putlong (XDR *xdrs, int32_t *v)
+{
+  char buf[BYTES_PER_XDR_UNIT];
+
+  if (xdrs->x__end - xdrs->x__cur >= BYTES_PER_XDR_UNIT) {
+    xdr__store32 (xdrs->x__cur, (uint32_t) *v);
+    xdrs->x__cur += BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+
+  /* Straddles two chunks. */
+  xdr__store32 (buf, (uint32_t) *v);
+  if (XDRCHUNK (xdrs) == NULL)
+    return FALSE;
+  return put_copy (xdrs, buf, sizeof buf);
+}
+
+static off_t
+xdrchunk_getpostn (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+
+  if (c == NULL)
+    return 0;
+  return c->cur_offset + (xdrs->x__cur - xdrs->x__base);
+}
+
+/* Seeking is allowed anywhere within the data encoded so far, which
+ * lets callers go back and patch in a length once it is known, but
+ * not into the middle of a referenced payload.
+ */
+static bool_t
+xdrchunk_setpostn (XDR *xdrs, off_t pos)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *ch;
+  off_t offset;
+
+  if (c == NULL)
+    return FALSE;
+
+  sync_length (xdrs);
+  if (pos < 0 || pos > c->length)
+    return FALSE;
+
+  close_chunk (xdrs);
+
+  for (ch = c->first, offset = 0;
+       ch->next && pos >= offset + (off_t) ch->size;
+       ch = ch->next)
+    offset += ch->size;
+
+  if (ch->alloc == 0)
+    return FALSE;
+
+  set_window (xdrs, ch, offset, pos - offset);
+  return TRUE;
+}
+
+static void *
+xdrchunk_inline (XDR *xdrs, size_t len)
+{
+  char *p = xdrs->x__cur;
+
+  if ((size_t) (xdrs->x__end - p) < len)
+    return NULL;
+  xdrs->x__cur = p + len;
+  return p;
+}
+
+static void
+xdrchunk_destroy (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *ch, *next;
+
+  if (c == NULL)
+    return;
+
+  for (ch = c->first; ch; ch = next) {
+    next = ch->next;
+    free (ch);
+  }
+  free (c->iov);
+  free (c->linear);
+  free (c);
+  xdrs->x__private = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+static const struct xdr_ops xdrchunk_ops = {
+  xdrchunk_getlong,
+  xdrchunk_putlong,
+  xdrchunk_getbytes,
+  xdrchunk_putbytes,
+  xdrchunk_getpostn,
+  xdrchunk_setpostn,
+  xdrchunk_inline,
+  xdrchunk_destroy
+};
+
+void
+xdrchunk_create (XDR *xdrs, size_t chunk_size)
+{
+  xdrchunk_create2 (xdrs, chunk_size, 0);
+}
+
+void
+xdrchunk_create2 (XDR *xdrs, size_t chunk_size, size_t threshold)
+{
+  struct xdrchunk *c;
+
+  if (chunk_size == 0)
+    chunk_size = XDRCHUNK_DEFAULT_SIZE;
+  chunk_size = RNDUP (chunk_size);
+
+  xdrs->x_op = XDR_ENCODE;
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrchunk_ops;
+  xdrs->x__private = NULL;
+  /* Payloads must reach xdrchunk_putbytes to be referenced. */
+  xdrs->x__flags = threshold > 0 ? XDR__REFERENCE : 0;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+
+  /* If this fails, every put on the stream will fail. */
+  c = calloc (1, sizeof *c);
+  if (c == NULL)
+    return;
+  c->chunk_size = chunk_size;
+  c->threshold = threshold;
+  c->first = malloc (sizeof (struct chunk) + chunk_size);
+  if (c->first == NULL) {
+    free (c);
+    return;
+  }
+  c->first->next = NULL;
+  c->first->data = c->first->buf;
+  c->first->size = 0;
+  c->first->alloc = chunk_size;
+
+  xdrs->x__private = c;
+  set_window (xdrs, c->first, 0, 0);
+}
+
+int
+xdrchunk_getiov (XDR *xdrs, struct iovec **iovp)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *ch;
+  off_t offset;
+  int n;
+
+  if (c == NULL)
+    return -1;
+
+  sync_length (xdrs);
+
+  close_chunk (xdrs);
+
+  n = 0;
+  for (ch = c->first, offset = 0; ch && offset < c->length; ch = ch->next) {
+    if (ch->size == 0 && ch->next)
+      continue;
+    if (n >= c->iov_alloc) {
+      int alloc = c->iov_alloc ? c->iov_alloc * 2 : 16;
+      struct iovec *iov = realloc (c->iov, alloc * sizeof *iov);
+      if (iov == NULL)
+	return -1;
+      c->iov = iov;
+      c->iov_alloc = alloc;
+    }
+    c->iov[n].iov_base = ch->data;
+    c->iov[n].iov_len = ch->size;
+    offset += ch->size;
+    n++;
+  }
+
+  *iovp = c->iov;
+  return n;
+}
+
+void *
+xdrchunk_linearize (XDR *xdrs, size_t *lenp)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct iovec *iov;
+  char *p;
+  int i, n;
+
+  n = xdrchunk_getiov (xdrs, &iov);
+  if (n == -1)
+    return NULL;
+
+  *lenp = c->length;
+
+  /* Data which fits in one chunk can be returned without copying. */
+  if (n == 0)
+    return c->first->data;
+  if (n == 1)
+    return iov[0].iov_base;
+
+  p = realloc (c->linear, c->length);
+  if (p == NULL)
+    return NULL;
+  c->linear = p;
+  for (i = 0; i < n; ++i) {
+    memcpy (p, iov[i].iov_base, iov[i].iov_len);
+    p += iov[i].iov_len;
+  }
+  return c->linear;
+}
+
+/* Discard the encoded data but keep the chunks we allocated, so the
+ * next message is encoded without calling malloc.  References to the
+ * caller's memory, and the tail chunks which followed them, own no
+ * buffer and are freed.
+ */
+void
+xdrchunk_reset (XDR *xdrs)
+{
+  struct xdrchunk *c = XDRCHUNK (xdrs);
+  struct chunk *ch, *next, **tailp;
+
+  if (c == NULL)
+    return;
+
+  tailp = &c->first;
+  for (ch = c->first; ch; ch = next) {
+    next = ch->next;
+    if (ch->data == ch->buf) {
+      ch->size = 0;
+      ch->alloc = c->chunk_size;
+      *tailp = ch;
+      tailp = &ch->next;
+    }
+    else
+      free (ch);
+  }
+  *tailp = NULL;
+
+  c->length = 0;
+  set_window (xdrs, c->first, 0, 0);
+}
@@ -0,0 +1,443 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* File descriptor streams, created by xdrfd_create and friends.
+ *
+ * The stream keeps its own buffer (64 KiB by default, configurable
+ * with xdrfd_create3) so that the number of system calls depends on
+ * the amount of data and not the number of XDR units.  The cursor
+ * fields in the XDR handle point into the buffer: when decoding they
+ * cover the bytes read but not yet consumed, and when encoding they
+ * cover the free space.
+ *
+ * Large xdr_getbytes and xdr_putbytes calls bypass the buffer, and
+ * when encoding the buffered data and the new bytes go out together
+ * in a single writev.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+#define XDRFD_DEFAULT_BUFSIZE 65536
+
+struct xdrfd {
+  int fd;
+  uint32_t flags;
+  off_t start;			/* file offset at creation, -1 if unknown */
+  off_t buf_offset;		/* stream offset of buf[0] */
+  size_t bufsize;
+  char buf[];
+};
+
+#define XDRFD(xdrs) ((struct xdrfd *) (xdrs)->x__private)
+
+bool_t
+xdr__write_all (int fd, struct iovec *iov, int iovcnt)
+{
+  ssize_t r;
+
+  while (iovcnt > 0) {
+    if (iov->iov_len == 0) {
+      iov++;
+      iovcnt--;
+      continue;
+    }
+#ifdef HAVE_WRITEV
+    r = writev (fd, iov, iovcnt);
+#else
+    r = write (fd, iov->iov_base, iov->iov_len);
+#endif
+    if (r == -1) {
+      if (errno == EINTR)
+	continue;
+      return FALSE;
+    }
+    while (iovcnt > 0 && (size_t) r >= iov->iov_len) {
+      r -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char *) iov->iov_base + r;
+      iov->iov_len -= r;
+    }
+  }
+  return TRUE;
+}
+
+/* Write the buffered data, plus (optionally) len bytes at p. */
+static bool_t
+flush (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+  struct iovec iov[2];
+  size_t n = xdrs->x__cur - f->buf;
+
+  iov[0].iov_base = f->buf;
+  iov[0].iov_len = n;
+  iov[1].iov_base = p;
+  iov[1].iov_len = len;
+  if (!xdr__write_all (f->fd, iov, 2))
+    return FALSE;
+
+  f->buf_offset += n + len;
+  xdrs->x__cur = f->buf;
+  return TRUE;
+}
+
+/* Read more data into the buffer until at least want bytes are
+ * available (want must be <= bufsize).  Any unconsumed bytes are
+ * moved to the start of the buffer first.
+ */
+static bool_t
+fill (XDR *xdrs, size_t want)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+  size_t have = xdrs->x__end - xdrs->x__cur;
+  ssize_t r;
+
+  f->buf_offset += xdrs->x__cur - f->buf;
+  memmove (f->buf, xdrs->x__cur, have);
+  xdrs->x__cur = f->buf;
+  xdrs->x__end = f->buf + have;
+
+  while (have < want) {
+    r = read (f->fd, f->buf + have, f->bufsize - have);
+    if (r == -1) {
+      if (errno == EINTR)
+	continue;
+      return FALSE;
+    }
+    if (r == 0)			/* Premature end of file. */
+      return FALSE;
+    have += r;
+    xdrs->x__end = f->buf + have;
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrfd_getlong (XDR *xdrs, int32_t *v)
+{
+  if (XDRFD (xdrs) == NULL)
+    return FALSE;
+  if (xdrs->x__end - xdrs->x__cur < BYTES_PER_XDR_UNIT &&
+      !fill (xdrs, BYTES_PER_XDR_UNIT))
+    return FALSE;
+  *v = (int32_t) xdr__load32 (xdrs->x__cur);
+  xdrs->x__cur += BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+
+static bool_t
+xdrfd_putlong (XDR *xdrs, int32_t *v)
+{
+  if (XDRFD (xdrs) == NULL)
+    return FALSE;
+  if (xdrs->x__end - xdrs->x__cur < BYTES_PER_XDR_UNIT &&
+      !flush (xdrs, NULL, 0))
+    return FALSE;
+  xdr__store32 (xdrs->x__cur, (uint32_t) *v);
+  xdrs->x__cur += BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+
+static bool_t
+xdrfd_getbytes (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+  char *dest = p;
+  size_t n;
+  ssize_t r;
+
+  if (f == NULL)
+    return FALSE;
+
+  n = xdrs->x__end - xdrs->x__cur;
+  if (n > len)
+    n = len;
+  memcpy (dest, xdrs->x__cur, n);
+  xdrs->x__cur += n;
+  dest += n;
+  len -= n;
+
+  if (len == 0)
+    return TRUE;
+
+  /* Small reads go through the buffer. */
+  if (len < f->bufsize) {
+    if (!fill (xdrs, len))
+      return FALSE;
+    memcpy (dest, xdrs->x__cur, len);
+    xdrs->x__cur += len;
+    return TRUE;
+  }
+
+  /* Large reads go straight into the caller's memory. */
+  f->buf_offset += xdrs->x__cur - f->buf;
+  xdrs->x__cur = xdrs->x__end = f->buf;
+  while (len > 0) {
+    r = read (f->fd, dest, len);
+    if (r == -1) {
+      if (errno == EINTR)
+	continue;
+      return FALSE;
+    }
+    if (r == 0)
+      return FALSE;
+    f->buf_offset += r;
+    dest += r;
+    len -= r;
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrfd_putbytes (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+
+  if (f == NULL)
+    return FALSE;
+
+  if ((size_t) (xdrs->x__end - xdrs->x__cur) >= len) {
+    memcpy (xdrs->x__cur, p, len);
+    xdrs->x__cur += len;
+    return TRUE;
+  }
+
+  /* Large writes go out with the buffered data in one writev. */
+  if (len >= f->bufsize)
+    return flush (xdrs, p, len);
+
+  if (!flush (xdrs, NULL, 0))
+    return FALSE;
+  memcpy (xdrs->x__cur, p, len);
+  xdrs->x__cur += len;
+  return TRUE;
+}
+
+static off_t
+xdrfd_getpostn (XDR *xdrs)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+
+  if (f == NULL)
+    return -1;
+  return f->buf_offset + (xdrs->x__cur - f->buf);
+}
+
+/* Seeking only works on files, not pipes or sockets.  When decoding,
+ * a seek which lands inside the buffer doesn't need a system call.
+ */
+static bool_t
+xdrfd_setpostn (XDR *xdrs, off_t pos)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+
+  if (f == NULL || pos < 0)
+    return FALSE;
+
+  if (xdrs->x_op == XDR_DECODE &&
+      pos >= f->buf_offset && pos <= f->buf_offset + (xdrs->x__end - f->buf)) {
+    xdrs->x__cur = f->buf + (pos - f->buf_offset);
+    return TRUE;
+  }
+
+  if (f->start == -1)
+    return FALSE;
+  if (xdrs->x_op == XDR_ENCODE && !flush (xdrs, NULL, 0))
+    return FALSE;
+  if (lseek (f->fd, f->start + pos, SEEK_SET) == -1)
+    return FALSE;
+
+  f->buf_offset = pos;
+  xdrs->x__cur = f->buf;
+  if (xdrs->x_op == XDR_DECODE)
+    xdrs->x__end = f->buf;
+  return TRUE;
+}
+
+static void *
+xdrfd_inline (XDR *xdrs, size_t len)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+  char *p;
+
+  if (f == NULL || len > f->bufsize)
+    return NULL;
+
+  if ((size_t) (xdrs->x__end - xdrs->x__cur) < len) {
+    if (xdrs->x_op == XDR_DECODE) {
+      if (!fill (xdrs, len))
+	return NULL;
+    }
+    else if (xdrs->x_op == XDR_ENCODE) {
+      if (!flush (xdrs, NULL, 0))
+	return NULL;
+    }
+    else
+      return NULL;
+  }
+
+  p = xdrs->x__cur;
+  xdrs->x__cur += len;
+  return p;
+}
+
+static void
+xdrfd_destroy (XDR *xdrs)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+
+  if (f == NULL)
+    return;
+  if (xdrs->x_op == XDR_ENCODE)
+    flush (xdrs, NULL, 0);
+  if (f->flags & XDR_CLOSE_FILE)
+    close (f->fd);
+  free (f);
+  xdrs->x__private = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+static const struct xdr_ops xdrfd_ops = {
+  xdrfd_getlong,
+  xdrfd_putlong,
+  xdrfd_getbytes,
+  xdrfd_putbytes,
+  xdrfd_getpostn,
+  xdrfd_setpostn,
+  xdrfd_inline,
+  xdrfd_destroy
+};
+
+void
+xdrfd_create (XDR *xdrs, int fd, enum xdr_op op)
+{
+  xdrfd_create3 (xdrs, fd, op, 0, 0);
+}
+
+void
+xdrfd_create2 (XDR *xdrs, int fd, enum xdr_op op, uint32_t flags)
+{
+  xdrfd_create3 (xdrs, fd, op, flags, 0);
+}
+
+void
+xdrfd_create3 (XDR *xdrs, int fd, enum xdr_op op, uint32_t flags,
+	       size_t bufsize)
+{
+  struct xdrfd *f;
+
+  if (bufsize == 0)
+    bufsize = XDRFD_DEFAULT_BUFSIZE;
+  bufsize = RNDUP (bufsize);
+
+  xdrs->x_op = op;
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrfd_ops;
+  xdrs->x__flags = 0;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+
+  /* If this fails, every operation on the stream will fail. */
+  f = malloc (sizeof *f + bufsize);
+  xdrs->x__private = f;
+  if (f == NULL)
+    return;
+
+  f->fd = fd;
+  f->flags = flags;
+  f->start = lseek (fd, 0, SEEK_CUR);
+  f->buf_offset = 0;
+  f->bufsize = bufsize;
+  xdrs->x__base = xdrs->x__cur = f->buf;
+  xdrs->x__end = op == XDR_ENCODE ? f->buf + bufsize : f->buf;
+}
+
+/* Rebind the stream to fd, keeping the buffer.  Pending output is
+ * written first.  If the descriptor stays the same, read-ahead which
+ * was never decoded is given back to the file where that is possible,
+ * so that switching from decoding to encoding writes at the point
+ * the decoder had reached.
+ */
+bool_t
+xdrfd_reset (XDR *xdrs, int fd, enum xdr_op op)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+  bool_t r = TRUE;
+
+  /* Creation failed to allocate the buffer, so try again. */
+  if (f == NULL) {
+    unsigned int flags = xdrs->x__flags;
+    struct xdr_arena *arena = xdrs->x__arena;
+
+    xdrfd_create3 (xdrs, fd, op, 0, 0);
+    xdrs->x__flags = flags;
+    xdrs->x__arena = arena;
+    return XDRFD (xdrs) != NULL;
+  }
+
+  if (xdrs->x_op == XDR_ENCODE)
+    r = flush (xdrs, NULL, 0);
+  else if (fd == f->fd && xdrs->x__end > xdrs->x__cur)
+    lseek (fd, -(off_t) (xdrs->x__end - xdrs->x__cur), SEEK_CUR);
+
+  if (fd != f->fd && (f->flags & XDR_CLOSE_FILE))
+    close (f->fd);
+
+  xdrs->x_op = op;
+  f->fd = fd;
+  f->start = lseek (fd, 0, SEEK_CUR);
+  f->buf_offset = 0;
+  xdrs->x__base = xdrs->x__cur = f->buf;
+  xdrs->x__end = op == XDR_ENCODE ? f->buf + f->bufsize : f->buf;
+  return r;
+}
+
+bool_t
+xdrfd_flush (XDR *xdrs)
+{
+  if (XDRFD (xdrs) == NULL)
+    return FALSE;
+  if (xdrs->x_op != XDR_ENCODE)
+    return TRUE;
+  return flush (xdrs, NULL, 0);
+}
+
+size_t
+xdrfd_buffered (XDR *xdrs)
+{
+  struct xdrfd *f = XDRFD (xdrs);
+
+  if (f == NULL)
+    return 0;
+  if (xdrs->x_op == XDR_ENCODE)
+    return xdrs->x__cur - f->buf;
+  return xdrs->x__end - xdrs->x__cur;
+}
@@ -0,0 +1,82 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* xdr_float and xdr_double.
+ *
+ * XDR uses IEEE 754 single and double precision, big-endian, which
+ * is what every host we care about uses in its own byte order.  So
+ * a float is sent exactly like a 32 bit integer with the same bits,
+ * and a double like a 64 bit integer: there is no need to take the
+ * number apart.  The copies through memcpy are how C lets us look at
+ * the bits, and compile to nothing.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+/* Fail to compile if the sizes are wrong. */
+typedef char xdr_float_size_check[sizeof (float) == 4 ? 1 : -1];
+typedef char xdr_double_size_check[sizeof (double) == 8 ? 1 : -1];
+
+bool_t
+xdr_float (XDR *xdrs, float *fp)
+{
+  int32_t t;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      memcpy (&t, fp, sizeof t);
+      return xdr_putlong (xdrs, &t);
+    case XDR_DECODE:
+      if (!xdr_getlong (xdrs, &t))
+	return FALSE;
+      memcpy (fp, &t, sizeof t);
+      return TRUE;
+    case XDR_FREE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+bool_t
+xdr_double (XDR *xdrs, double *dp)
+{
+  int64_t t;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      memcpy (&t, dp, sizeof t);
+      return xdr_puthyper (xdrs, &t);
+    case XDR_DECODE:
+      if (!xdr_gethyper (xdrs, &t))
+	return FALSE;
+      memcpy (dp, &t, sizeof t);
+      return TRUE;
+    case XDR_FREE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
@@ -0,0 +1,231 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Fragmented decode streams, created by xdrfrag_create.
+ *
+ * The input is an array of (pointer, length) segments, such as a
+ * chain of network receive buffers.  The cursor fields in the XDR
+ * handle describe the current segment, so most operations run at
+ * the same speed as on a memory stream, and only values which cross
+ * a segment boundary take the slow path.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+struct xdrfrag {
+  const struct iovec *iov;	/* caller's segments */
+  int iovcnt;
+  int seg;			/* current segment */
+  off_t seg_offset;		/* stream offset of current segment */
+};
+
+#define XDRFRAG(xdrs) ((struct xdrfrag *) (xdrs)->x__private)
+
+static void
+set_segment (XDR *xdrs, int seg, off_t seg_offset)
+{
+  struct xdrfrag *f = XDRFRAG (xdrs);
+
+  f->seg = seg;
+  f->seg_offset = seg_offset;
+  if (seg < f->iovcnt) {
+    xdrs->x__base = xdrs->x__cur = (char *) f->iov[seg].iov_base;
+    xdrs->x__end = xdrs->x__base + f->iov[seg].iov_len;
+  }
+  else
+    xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+/* If the current segment is used up, move to the next non-empty
+ * one.  Returns FALSE at the end of the input.
+ */
+static bool_t
+next_segment (XDR *xdrs)
+{
+  struct xdrfrag *f = XDRFRAG (xdrs);
+
+  while (xdrs->x__cur == xdrs->x__end) {
+    if (f == NULL || f->seg >= f->iovcnt)
+      return FALSE;
+    set_segment (xdrs, f->seg + 1,
+		 f->seg_offset + (xdrs->x__end - xdrs->x__base));
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrfrag_getbytes (XDR *xdrs, void *p, size_t len)
+{
+  char *dest = p;
+  size_t n;
+
+  while (len > 0) {
+    if (!next_segment (xdrs))
+      return FALSE;
+    n = xdrs->x__end - xdrs->x__cur;
+    if (n > len)
+      n = len;
+    memcpy (dest, xdrs->x__cur, n);
+    xdrs->x__cur += n;
+    dest += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrfrag_getlong (XDR *xdrs, int32_t *v)
+{
+  char buf[BYTES_PER_XDR_UNIT];
+
+  if (xdrs->x__end - xdrs->x__cur >= BYTES_PER_XDR_UNIT) {
+    *v = (int32_t) xdr__load32 (xdrs->x__cur);
+    xdrs->x__cur += BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+
+  /* Straddles two segments. */
+  if (!xdrfrag_getbytes (xdrs, buf, sizeof buf))
+    return FALSE;
+  *v = (int32_t) xdr__load32 (buf);
+  return TRUE;
+}
+
+static bool_t
+xdrfrag_putlong (XDR *xdrs ATTRIBUTE_UNUSED, int32_t *v ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static bool_t
+xdrfrag_putbytes (XDR *xdrs ATTRIBUTE_UNUSED, void *p ATTRIBUTE_UNUSED,
+		  size_t len ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static off_t
+xdrfrag_getpostn (XDR *xdrs)
+{
+  struct xdrfrag *f = XDRFRAG (xdrs);
+
+  if (f == NULL)
+    return 0;
+  return f->seg_offset + (xdrs->x__cur - xdrs->x__base);
+}
+
+static bool_t
+xdrfrag_setpostn (XDR *xdrs, off_t pos)
+{
+  struct xdrfrag *f = XDRFRAG (xdrs);
+  off_t offset = 0;
+  int seg;
+
+  if (f == NULL || pos < 0)
+    return FALSE;
+
+  for (seg = 0; seg < f->iovcnt; ++seg) {
+    if (pos <= offset + (off_t) f->iov[seg].iov_len) {
+      set_segment (xdrs, seg, offset);
+      xdrs->x__cur += pos - offset;
+      return TRUE;
+    }
+    offset += f->iov[seg].iov_len;
+  }
+  return FALSE;
+}
+
+/* Succeeds only if the requested bytes are contiguous, ie. they lie
+ * entirely within one segment.
+ */
+static void *
+xdrfrag_inline (XDR *xdrs, size_t len)
+{
+  char *p;
+
+  if (len > 0 && !next_segment (xdrs))
+    return NULL;
+  p = xdrs->x__cur;
+  if ((size_t) (xdrs->x__end - p) < len)
+    return NULL;
+  xdrs->x__cur = p + len;
+  return p;
+}
+
+static void
+xdrfrag_destroy (XDR *xdrs)
+{
+  free (xdrs->x__private);
+  xdrs->x__private = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+static const struct xdr_ops xdrfrag_ops = {
+  xdrfrag_getlong,
+  xdrfrag_putlong,
+  xdrfrag_getbytes,
+  xdrfrag_putbytes,
+  xdrfrag_getpostn,
+  xdrfrag_setpostn,
+  xdrfrag_inline,
+  xdrfrag_destroy
+};
+
+void
+xdrfrag_create (XDR *xdrs, const struct iovec *iov, int iovcnt)
+{
+  struct xdrfrag *f;
+
+  xdrs->x_op = XDR_DECODE;
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrfrag_ops;
+  xdrs->x__flags = XDR__STABLE | XDR__WRITABLE;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+
+  /* If this fails, every get on the stream will fail. */
+  f = malloc (sizeof *f);
+  xdrs->x__private = f;
+  if (f == NULL)
+    return;
+  f->iov = iov;
+  f->iovcnt = iovcnt;
+  set_segment (xdrs, 0, 0);
+}
+
+void
+xdrfrag_reset (XDR *xdrs, const struct iovec *iov, int iovcnt)
+{
+  struct xdrfrag *f = XDRFRAG (xdrs);
+
+  if (f == NULL) {
+    xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+    return;
+  }
+  f->iov = iov;
+  f->iovcnt = iovcnt;
+  set_segment (xdrs, 0, 0);
+}
@@ -0,0 +1,410 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Record indexes, created by xdr_index_create, and parallel decoding
+ * of the indexed records with xdr_index_decode.
+ *
+ * The framing pass only reads the record headers and never touches
+ * the payload.  Each record is kept as a range of fragments, and
+ * almost always there is just one, so that the record can be decoded
+ * through a memory stream.  Records made of several fragments are
+ * decoded through a fragmented stream (xdr_frag.c) without copying.
+ *
+ * Each worker thread claims the next record, decodes it into a new
+ * object, and puts the result into a window of pending results.  The
+ * window bounds how far decoding may run ahead of delivery.  Results
+ * are delivered by whichever worker finds the next one ready while
+ * no other worker is delivering, so the delivery callback is never
+ * called concurrently.  For ordered delivery a record's place in the
+ * window is its index; for unordered delivery it is the order in
+ * which decoding finished.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+struct index_record {
+  size_t frag;			/* first fragment */
+  size_t nfrags;
+};
+
+struct xdr_index {
+  struct iovec *frags;
+  size_t nfrags, frags_alloc;
+  struct index_record *records;
+  size_t nrecords, records_alloc;
+};
+
+static bool_t
+add_frag (struct xdr_index *index, const char *p, size_t len)
+{
+  if (index->nfrags == index->frags_alloc) {
+    size_t alloc = index->frags_alloc ? index->frags_alloc * 2 : 1024;
+    struct iovec *frags = realloc (index->frags, alloc * sizeof *frags);
+    if (frags == NULL)
+      return FALSE;
+    index->frags = frags;
+    index->frags_alloc = alloc;
+  }
+  index->frags[index->nfrags].iov_base = (char *) p;
+  index->frags[index->nfrags].iov_len = len;
+  index->nfrags++;
+  return TRUE;
+}
+
+static bool_t
+add_record (struct xdr_index *index, size_t frag)
+{
+  if (index->nrecords == index->records_alloc) {
+    size_t alloc = index->records_alloc ? index->records_alloc * 2 : 1024;
+    struct index_record *records =
+      realloc (index->records, alloc * sizeof *records);
+    if (records == NULL)
+      return FALSE;
+    index->records = records;
+    index->records_alloc = alloc;
+  }
+  index->records[index->nrecords].frag = frag;
+  index->records[index->nrecords].nfrags = index->nfrags - frag;
+  index->nrecords++;
+  return TRUE;
+}
+
+struct xdr_index *
+xdr_index_create (const void *buf, size_t len, int framing)
+{
+  struct xdr_index *index;
+  const char *p = buf, *end = p + len;
+  uint32_t h;
+  size_t n, first = 0;
+
+  if (framing != XDR_INDEX_RECORD_MARKING &&
+      framing != XDR_INDEX_LENGTH_PREFIXED) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  index = calloc (1, sizeof *index);
+  if (index == NULL)
+    return NULL;
+
+  while (p < end) {
+    if (end - p < BYTES_PER_XDR_UNIT)
+      goto bad;
+    h = xdr__load32 (p);
+    p += BYTES_PER_XDR_UNIT;
+
+    if (framing == XDR_INDEX_RECORD_MARKING) {
+      n = h & 0x7fffffff;
+      if ((size_t) (end - p) < n)
+	goto bad;
+      if (!add_frag (index, p, n))
+	goto error;
+      p += n;
+      if (h & 0x80000000) {
+	if (!add_record (index, first))
+	  goto error;
+	first = index->nfrags;
+      }
+    }
+    else {
+      n = h;
+      if ((size_t) (end - p) < n || (size_t) (end - p) < RNDUP (n))
+	goto bad;
+      if (!add_frag (index, p, n) || !add_record (index, first))
+	goto error;
+      first = index->nfrags;
+      p += RNDUP (n);
+    }
+  }
+
+  /* The last record must be complete. */
+  if (first != index->nfrags)
+    goto bad;
+
+  return index;
+
+ bad:
+  errno = EINVAL;
+ error:
+  xdr_index_destroy (index);
+  return NULL;
+}
+
+void
+xdr_index_destroy (struct xdr_index *index)
+{
+  if (index == NULL)
+    return;
+  free (index->frags);
+  free (index->records);
+  free (index);
+}
+
+size_t
+xdr_index_count (const struct xdr_index *index)
+{
+  return index->nrecords;
+}
+
+bool_t
+xdr_index_record (const struct xdr_index *index, size_t i, XDR *xdrs)
+{
+  const struct index_record *r;
+
+  if (i >= index->nrecords) {
+    xdrmem_create (xdrs, NULL, 0, XDR_DECODE);
+    return FALSE;
+  }
+
+  r = &index->records[i];
+  if (r->nfrags == 1)
+    xdrmem_create (xdrs, index->frags[r->frag].iov_base,
+		   index->frags[r->frag].iov_len, XDR_DECODE);
+  else
+    xdrfrag_create (xdrs, &index->frags[r->frag], r->nfrags);
+  return TRUE;
+}
+
+/* Parallel decoding. */
+
+#define WINDOW_PER_THREAD 16
+#define MAX_THREADS 256
+
+struct result {
+  void *obj;
+  size_t i;
+  bool_t ready;
+};
+
+struct decode_job {
+  const struct xdr_index *index;
+  xdrproc_t proc;
+  size_t size;
+  bool_t ordered;
+  bool_t (*deliver) (void *opaque, size_t i, void *obj);
+  void *opaque;
+
+#ifdef HAVE_PTHREAD_CREATE
+  pthread_mutex_t lock;
+  pthread_cond_t cond;		/* window space, or stop */
+#endif
+  struct result *window;
+  size_t window_size;
+  size_t next;			/* next record to decode */
+  size_t finished;		/* records decoded */
+  size_t delivered;		/* results delivered */
+  bool_t delivering;
+  bool_t stop;
+  int err;
+};
+
+#ifdef HAVE_PTHREAD_CREATE
+#define LOCK(job) pthread_mutex_lock (&(job)->lock)
+#define UNLOCK(job) pthread_mutex_unlock (&(job)->lock)
+#define WAIT(job) pthread_cond_wait (&(job)->cond, &(job)->lock)
+#define WAKE(job) pthread_cond_broadcast (&(job)->cond)
+#else
+#define LOCK(job) ((void) 0)
+#define UNLOCK(job) ((void) 0)
+#define WAIT(job) ((void) 0)
+#define WAKE(job) ((void) 0)
+#endif
+
+static void
+free_obj (struct decode_job *job, void *obj)
+{
+  xdr_free (job->proc, obj);
+  free (obj);
+}
+
+static void
+set_error (struct decode_job *job, int err)
+{
+  if (!job->stop) {
+    job->stop = TRUE;
+    job->err = err;
+  }
+  WAKE (job);
+}
+
+/* Deliver results until the next one isn't ready.  Called and
+ * returns with the lock held, but drops it around each callback.
+ */
+static void
+deliver_ready (struct decode_job *job)
+{
+  struct result *r;
+  void *obj;
+  size_t i;
+  bool_t ok;
+
+  if (job->delivering)
+    return;
+  job->delivering = TRUE;
+
+  while (!job->stop) {
+    r = &job->window[job->delivered % job->window_size];
+    if (!r->ready)
+      break;
+    obj = r->obj;
+    i = r->i;
+    r->ready = FALSE;
+
+    UNLOCK (job);
+    ok = job->deliver (job->opaque, i, obj);
+    LOCK (job);
+
+    job->delivered++;
+    if (!ok)
+      set_error (job, 0);
+    WAKE (job);
+  }
+
+  job->delivering = FALSE;
+}
+
+static void *
+worker (void *jobv)
+{
+  struct decode_job *job = jobv;
+  struct result *r;
+  void *obj;
+  size_t i;
+  bool_t ok;
+  XDR xdrs;
+
+  LOCK (job);
+  for (;;) {
+    while (!job->stop && job->next < job->index->nrecords &&
+	   job->next - job->delivered >= job->window_size)
+      WAIT (job);
+    if (job->stop || job->next >= job->index->nrecords)
+      break;
+    i = job->next++;
+    UNLOCK (job);
+
+    obj = calloc (1, job->size);
+    ok = obj != NULL;
+    if (ok) {
+      xdr_index_record (job->index, i, &xdrs);
+      ok = job->proc (&xdrs, obj);
+      xdr_destroy (&xdrs);
+      if (!ok)
+	free_obj (job, obj);
+    }
+
+    LOCK (job);
+    if (!ok) {
+      set_error (job, obj ? EINVAL : ENOMEM);
+      break;
+    }
+    if (job->stop) {
+      free_obj (job, obj);
+      break;
+    }
+
+    r = &job->window[(job->ordered ? i : job->finished) % job->window_size];
+    job->finished++;
+    r->obj = obj;
+    r->i = i;
+    r->ready = TRUE;
+    deliver_ready (job);
+  }
+  UNLOCK (job);
+  return NULL;
+}
+
+bool_t
+xdr_index_decode (const struct xdr_index *index, xdrproc_t proc,
+		  size_t size, int nthreads, unsigned int flags,
+		  bool_t (*deliver) (void *opaque, size_t i, void *obj),
+		  void *opaque)
+{
+  struct decode_job job;
+#ifdef HAVE_PTHREAD_CREATE
+  pthread_t threads[MAX_THREADS];
+  int i, n = 0;
+#endif
+  size_t j;
+
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+
+  memset (&job, 0, sizeof job);
+  job.index = index;
+  job.proc = proc;
+  job.size = size;
+  job.ordered = !(flags & XDR_INDEX_UNORDERED);
+  job.deliver = deliver;
+  job.opaque = opaque;
+  job.window_size = (size_t) nthreads * WINDOW_PER_THREAD;
+  job.window = calloc (job.window_size, sizeof *job.window);
+  if (job.window == NULL)
+    return FALSE;
+
+#ifdef HAVE_PTHREAD_CREATE
+  pthread_mutex_init (&job.lock, NULL);
+  pthread_cond_init (&job.cond, NULL);
+
+  /* The calling thread is one of the workers.  If some threads can't
+   * be created, carry on with fewer.
+   */
+  for (i = 1; i < nthreads; ++i) {
+    if (pthread_create (&threads[n], NULL, worker, &job) != 0)
+      break;
+    n++;
+  }
+#endif
+
+  worker (&job);
+
+#ifdef HAVE_PTHREAD_CREATE
+  for (i = 0; i < n; ++i)
+    pthread_join (threads[i], NULL);
+  pthread_cond_destroy (&job.cond);
+  pthread_mutex_destroy (&job.lock);
+#endif
+
+  /* After an error, free the results which were never delivered. */
+  for (j = 0; j < job.window_size; ++j)
+    if (job.window[j].ready)
+      free_obj (&job, job.window[j].obj);
+  free (job.window);
+
+  if (job.stop) {
+    if (job.err)
+      errno = job.err;
+    return FALSE;
+  }
+  return TRUE;
+}
@@ -0,0 +1,198 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Memory streams, created by xdrmem_create, and read-only streams
+ * over a memory mapped file, created by xdrmmap_create.
+ *
+ * The whole stream state lives in the cursor fields of the XDR
+ * handle (x__base, x__cur, x__end), so creating a memory stream
+ * does not allocate and every operation is a bounds check followed
+ * by a load or store.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+/* getlong, putlong, getbytes, putbytes and inline are the inline
+ * cursor operations from <rpc/xdr_internal.h>.
+ */
+
+static off_t
+xdrmem_getpostn (XDR *xdrs)
+{
+  return xdrs->x__cur - xdrs->x__base;
+}
+
+static bool_t
+xdrmem_setpostn (XDR *xdrs, off_t pos)
+{
+  if (pos < 0 || pos > xdrs->x__end - xdrs->x__base)
+    return FALSE;
+  xdrs->x__cur = xdrs->x__base + pos;
+  return TRUE;
+}
+
+static void
+xdrmem_destroy (XDR *xdrs ATTRIBUTE_UNUSED)
+{
+  /* The buffer belongs to the caller. */
+}
+
+static const struct xdr_ops xdrmem_ops = {
+  xdrmem_getlong,
+  xdrmem_putlong,
+  xdrmem_getbytes,
+  xdrmem_putbytes,
+  xdrmem_getpostn,
+  xdrmem_setpostn,
+  xdrmem_inline,
+  xdrmem_destroy
+};
+
+void
+xdrmem_create (XDR *xdrs, void *p, size_t size, enum xdr_op op)
+{
+  xdrs->x_op = op;
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrmem_ops;
+  xdrs->x__private = NULL;
+  xdrs->x__flags = XDR__STABLE | XDR__WRITABLE;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = (char *) p;
+  xdrs->x__end = (char *) p + size;
+}
+
+void
+xdrmem_reset (XDR *xdrs, void *p, size_t size, enum xdr_op op)
+{
+  xdrs->x_op = op;
+  xdrs->x__flags = (xdrs->x__flags & ~XDR__PRIVATE) | XDR__STABLE | XDR__WRITABLE;
+  xdrs->x__base = xdrs->x__cur = (char *) p;
+  xdrs->x__end = (char *) p + size;
+}
+
+/* A mapped file is read-only, so puts must fail cleanly rather than
+ * fault.
+ */
+static bool_t
+xdrmmap_putlong (XDR *xdrs ATTRIBUTE_UNUSED, int32_t *v ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static bool_t
+xdrmmap_putbytes (XDR *xdrs ATTRIBUTE_UNUSED, void *p ATTRIBUTE_UNUSED,
+		  size_t len ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static void
+xdrmmap_destroy (XDR *xdrs)
+{
+#ifdef HAVE_MMAP
+  if (xdrs->x__base)
+    munmap (xdrs->x__base, xdrs->x__end - xdrs->x__base);
+#endif
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+static const struct xdr_ops xdrmmap_ops = {
+  xdrmem_getlong,
+  xdrmmap_putlong,
+  xdrmem_getbytes,
+  xdrmmap_putbytes,
+  xdrmem_getpostn,
+  xdrmem_setpostn,
+  xdrmem_inline,
+  xdrmmap_destroy
+};
+
+bool_t
+xdrmmap_create (XDR *xdrs, int fd, uint32_t flags)
+{
+#ifdef HAVE_MMAP
+  struct stat statbuf;
+  void *p = NULL;
+  size_t size;
+  int err;
+
+  /* On error, leave behind an empty stream which is safe to use
+   * and destroy.
+   */
+  xdrmem_create (xdrs, NULL, 0, XDR_DECODE);
+  xdrs->x_ops = &xdrmmap_ops;
+  xdrs->x__flags = XDR__STABLE;
+
+  if (fstat (fd, &statbuf) == -1)
+    goto error;
+  if ((uintmax_t) statbuf.st_size > SIZE_MAX) {
+    errno = EFBIG;
+    goto error;
+  }
+  size = statbuf.st_size;
+
+  if (size > 0) {
+    p = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+      goto error;
+
+#ifdef HAVE_MADVISE
+    /* The advice is only a hint, so ignore errors. */
+    madvise (p, size,
+	     flags & XDR_MMAP_RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+    if (flags & XDR_MMAP_WILLNEED)
+      madvise (p, size, MADV_WILLNEED);
+#endif
+  }
+
+  /* The mapping stays valid after the file is closed. */
+  if (flags & XDR_CLOSE_FILE)
+    close (fd);
+
+  xdrs->x__base = xdrs->x__cur = p;
+  xdrs->x__end = (char *) p + size;
+  return TRUE;
+
+ error:
+  err = errno;
+  if (flags & XDR_CLOSE_FILE)
+    close (fd);
+  errno = err;
+  return FALSE;
+#else
+  xdrmem_create (xdrs, NULL, 0, XDR_DECODE);
+  if (flags & XDR_CLOSE_FILE)
+    close (fd);
+  errno = ENOSYS;
+  return FALSE;
+#endif
+}
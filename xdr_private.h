@@ -0,0 +1,129 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Definitions private to the library. */
+
+#ifndef PORTABLEXDR_XDR_PRIVATE_H
+#define PORTABLEXDR_XDR_PRIVATE_H
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+/* Copy n 32 or 64 bit units from src to dest, converting between
+ * host and XDR (big-endian) byte order.  src and dest may be the
+ * same, but must not otherwise overlap.  These pick the fastest
+ * implementation for the CPU the first time they are called.
+ */
+extern void xdr__swap32 (void *dest, const void *src, size_t n);
+extern void xdr__swap64 (void *dest, const void *src, size_t n);
+
+/* Encode or decode n contiguous units of unit_size (4 or 8) bytes. */
+extern bool_t xdr__vector_units (XDR *xdrs, void *p, size_t n, size_t unit_size);
+
+/* Allocate memory for decoded data, from the stream's arena if it
+ * has one, otherwise with malloc or calloc.
+ */
+extern void *xdr__alloc (XDR *xdrs, size_t size);
+extern void *xdr__calloc (XDR *xdrs, size_t n, size_t size);
+
+/* Grow a buffer left by an earlier decode (see XDR_DECODE_REUSE)
+ * so that it holds at least size bytes.  known is the size the
+ * buffer is known to have, used if the real size can't be found.
+ * Returns NULL if it can't be grown, leaving the buffer untouched.
+ */
+extern void *xdr__reuse (void *p, size_t known, size_t size);
+
+/* Write all of iov to fd, retrying after short writes and signals.
+ * The iov array is modified.
+ */
+extern bool_t xdr__write_all (int fd, struct iovec *iov, int iovcnt);
+
+/* Private bits in x__flags. */
+#define XDR__PRIVATE  0xff000000U
+#define XDR__SIZEOF   0x80000000U /* counting stream made by xdr_sizeof */
+#define XDR__STABLE   0x40000000U /* xdr_inline points into caller's memory */
+#define XDR__WRITABLE 0x20000000U /* ... which may be written to */
+#define XDR__BORROWED 0x10000000U /* xdr_free_borrowed, see xdr__free */
+#define XDR__VALIDATE 0x08000000U /* memory stream made by xdr_validate */
+/* XDR__REFERENCE 0x04000000U is in <rpc/xdr_internal.h>. */
+
+/* The private data of an xdr_sizeof stream.  Encoders of variable
+ * length data use xdr__sizeof_add to account for it directly
+ * instead of passing the payload through the stream.
+ */
+struct xdrsizeof {
+  size_t count;			/* bytes "encoded" so far */
+  void *scratch;		/* buffer returned by xdr_inline */
+  size_t scratch_size;
+};
+
+/* If true, xdr_bytes and xdr_string may return pointers into the
+ * input instead of copying.
+ */
+static inline bool_t
+xdr__borrowing (XDR *xdrs)
+{
+  return (xdrs->x__flags & (XDR_DECODE_BORROW | XDR__STABLE)) ==
+    (XDR_DECODE_BORROW | XDR__STABLE);
+}
+
+/* If true, decoders reuse the buffers which they find in the object
+ * instead of allocating new ones.  This doesn't apply to arena or
+ * borrowed memory, which can't be resized.
+ */
+static inline bool_t
+xdr__reusing (XDR *xdrs)
+{
+  return (xdrs->x__flags & XDR_DECODE_REUSE) && xdrs->x__arena == NULL &&
+    !xdr__borrowing (xdrs);
+}
+
+/* If true, the stream is only checking the input (see xdr_validate).
+ * Decoders must not allocate, and data which doesn't need to be
+ * looked at should be skipped with xdr__skip.
+ */
+static inline bool_t
+xdr__validating (XDR *xdrs)
+{
+  return (xdrs->x__flags & XDR__VALIDATE) != 0;
+}
+
+/* Skip len bytes of data plus padding, checking that they are
+ * present and that the padding is zero.
+ */
+extern bool_t xdr__skip (XDR *xdrs, size_t len);
+
+/* Validate n elements, decoding each into scratch space. */
+extern bool_t xdr__validate_elements (XDR *xdrs, size_t n, size_t element_size, xdrproc_t element_proc);
+
+/* Free data which may have been borrowed from the input. */
+extern void xdr__free (XDR *xdrs, void *p);
+
+static inline bool_t
+xdr__counting (XDR *xdrs)
+{
+  return (xdrs->x__flags & XDR__SIZEOF) != 0;
+}
+
+static inline void
+xdr__sizeof_add (XDR *xdrs, size_t len)
+{
+  ((struct xdrsizeof *) xdrs->x__private)->count += len;
+}
+
+#endif /* PORTABLEXDR_XDR_PRIVATE_H */
@@ -0,0 +1,520 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Record marking streams, created by xdrrec_create.
+ *
+ * This is the framing described in RFC 5531 section 11: each record
+ * is sent as one or more fragments, and each fragment is preceded by
+ * a 4 byte header containing its length, with the top bit set on the
+ * last fragment of the record.
+ *
+ * The send buffer can hold several fragments (see xdrrec_create2),
+ * and is only passed to writeit when it is full or when the caller
+ * ends a record with sendnow set, so a record made of many small
+ * fragments still costs one write.
+ *
+ * As in SunRPC, the receive side starts out positioned at the end of
+ * a record, so callers must call xdrrec_skiprecord before decoding
+ * each record.
+ *
+ * Because SunRPC code flips x_op between encoding and decoding on
+ * the same handle, the cursors for the two directions are kept here
+ * and not in the XDR handle.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#define XDRREC_DEFAULT_BUFSIZE 65536
+#define LAST_FRAG 0x80000000U
+
+struct xdrrec {
+  void *handle;
+  int (*readit) (void *, void *, int);
+  int (*writeit) (void *, void *, int);
+
+  /* Output. */
+  char *out_buf;
+  char *out_end;		/* end of out_buf */
+  char *out_cur;
+  char *out_boundary;		/* end of current fragment */
+  char *frag_header;		/* header of current fragment */
+  uint32_t frag_size;		/* maximum fragment length */
+
+  /* Input. */
+  char *in_buf;
+  size_t in_size;
+  char *in_cur;
+  char *in_fill;		/* end of data read into in_buf */
+  uint32_t frag_left;		/* bytes left in current fragment */
+  bool_t last_frag;		/* current fragment is the last */
+
+  char buf[];
+};
+
+#define XDRREC(xdrs) ((struct xdrrec *) (xdrs)->x__private)
+
+/*----- Output. -----*/
+
+static bool_t
+flush_out (struct xdrrec *r)
+{
+  int len = r->out_cur - r->out_buf;
+
+  if (len > 0 && r->writeit (r->handle, r->out_buf, len) != len)
+    return FALSE;
+  r->out_cur = r->out_buf;
+  return TRUE;
+}
+
+static void
+end_fragment (struct xdrrec *r, bool_t last)
+{
+  uint32_t len = r->out_cur - r->frag_header - BYTES_PER_XDR_UNIT;
+
+  xdr__store32 (r->frag_header, len | (last ? LAST_FRAG : 0));
+}
+
+/* Start a new fragment, first writing out the buffer if there isn't
+ * room for a header and at least one unit of data.
+ */
+static bool_t
+start_fragment (struct xdrrec *r)
+{
+  if (r->out_end - r->out_cur < 2 * BYTES_PER_XDR_UNIT && !flush_out (r))
+    return FALSE;
+
+  r->frag_header = r->out_cur;
+  r->out_cur += BYTES_PER_XDR_UNIT;
+  r->out_boundary = r->out_cur + r->frag_size;
+  if (r->out_boundary > r->out_end)
+    r->out_boundary = r->out_end;
+  return TRUE;
+}
+
+static bool_t
+xdrrec_putbytes (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  const char *src = p;
+  size_t n;
+
+  if (r == NULL)
+    return FALSE;
+
+  while (len > 0) {
+    if (r->out_cur == r->out_boundary) {
+      end_fragment (r, FALSE);
+      if (!start_fragment (r))
+	return FALSE;
+    }
+    n = r->out_boundary - r->out_cur;
+    if (n > len)
+      n = len;
+    memcpy (r->out_cur, src, n);
+    r->out_cur += n;
+    src += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrrec_putlong (XDR *xdrs, int32_t *v)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  char buf[BYTES_PER_XDR_UNIT];
+
+  if (r == NULL)
+    return FALSE;
+
+  if (r->out_boundary - r->out_cur >= BYTES_PER_XDR_UNIT) {
+    xdr__store32 (r->out_cur, (uint32_t) *v);
+    r->out_cur += BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+
+  xdr__store32 (buf, (uint32_t) *v);
+  return xdrrec_putbytes (xdrs, buf, sizeof buf);
+}
+
+/* Store whole units while they fit in the current fragment, and
+ * let xdrrec_putlong deal with fragment boundaries.
+ */
+static bool_t
+xdrrec_putlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  size_t i, k;
+
+  if (r == NULL)
+    return FALSE;
+
+  while (n > 0) {
+    k = (r->out_boundary - r->out_cur) / BYTES_PER_XDR_UNIT;
+    if (k == 0) {
+      if (!xdrrec_putlong (xdrs, v))
+	return FALSE;
+      k = 1;
+    }
+    else {
+      if (k > n)
+	k = n;
+      for (i = 0; i < k; ++i)
+	xdr__store32 (r->out_cur + i * BYTES_PER_XDR_UNIT, (uint32_t) v[i]);
+      r->out_cur += k * BYTES_PER_XDR_UNIT;
+    }
+    v += k;
+    n -= k;
+  }
+  return TRUE;
+}
+
+bool_t
+xdrrec_endofrecord (XDR *xdrs, bool_t sendnow)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+
+  if (r == NULL)
+    return FALSE;
+
+  end_fragment (r, TRUE);
+  if (sendnow && !flush_out (r))
+    return FALSE;
+  return start_fragment (r);
+}
+
+/*----- Input. -----*/
+
+static bool_t
+fill_input (struct xdrrec *r)
+{
+  int n = r->readit (r->handle, r->in_buf, r->in_size);
+
+  if (n <= 0)
+    return FALSE;
+  r->in_cur = r->in_buf;
+  r->in_fill = r->in_buf + n;
+  return TRUE;
+}
+
+/* Get bytes from the input, ignoring fragment boundaries. */
+static bool_t
+get_input_bytes (struct xdrrec *r, char *p, size_t len)
+{
+  size_t n;
+
+  while (len > 0) {
+    if (r->in_cur == r->in_fill && !fill_input (r))
+      return FALSE;
+    n = r->in_fill - r->in_cur;
+    if (n > len)
+      n = len;
+    if (p) {
+      memcpy (p, r->in_cur, n);
+      p += n;
+    }
+    r->in_cur += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static bool_t
+set_input_fragment (struct xdrrec *r)
+{
+  char buf[BYTES_PER_XDR_UNIT];
+  uint32_t header;
+
+  if (!get_input_bytes (r, buf, sizeof buf))
+    return FALSE;
+  header = xdr__load32 (buf);
+
+  /* An empty fragment which isn't the last one is pointless, and
+   * would let a peer keep us busy forever.
+   */
+  if (header == 0)
+    return FALSE;
+
+  r->last_frag = (header & LAST_FRAG) != 0;
+  r->frag_left = header & ~LAST_FRAG;
+  return TRUE;
+}
+
+static bool_t
+xdrrec_getbytes (XDR *xdrs, void *p, size_t len)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  char *dest = p;
+  size_t n;
+
+  if (r == NULL)
+    return FALSE;
+
+  while (len > 0) {
+    if (r->frag_left == 0) {
+      if (r->last_frag || !set_input_fragment (r))
+	return FALSE;
+      continue;
+    }
+    n = r->frag_left;
+    if (n > len)
+      n = len;
+    if (!get_input_bytes (r, dest, n))
+      return FALSE;
+    r->frag_left -= n;
+    dest += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static bool_t
+xdrrec_getlong (XDR *xdrs, int32_t *v)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  char buf[BYTES_PER_XDR_UNIT];
+
+  if (r == NULL)
+    return FALSE;
+
+  if (r->frag_left >= BYTES_PER_XDR_UNIT &&
+      r->in_fill - r->in_cur >= BYTES_PER_XDR_UNIT) {
+    *v = (int32_t) xdr__load32 (r->in_cur);
+    r->in_cur += BYTES_PER_XDR_UNIT;
+    r->frag_left -= BYTES_PER_XDR_UNIT;
+    return TRUE;
+  }
+
+  if (!xdrrec_getbytes (xdrs, buf, sizeof buf))
+    return FALSE;
+  *v = (int32_t) xdr__load32 (buf);
+  return TRUE;
+}
+
+static bool_t
+xdrrec_getlongs (XDR *xdrs, int32_t *v, size_t n)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  size_t i, k;
+
+  if (r == NULL)
+    return FALSE;
+
+  while (n > 0) {
+    k = r->frag_left;
+    if (k > (size_t) (r->in_fill - r->in_cur))
+      k = r->in_fill - r->in_cur;
+    k /= BYTES_PER_XDR_UNIT;
+    if (k == 0) {
+      if (!xdrrec_getlong (xdrs, v))
+	return FALSE;
+      k = 1;
+    }
+    else {
+      if (k > n)
+	k = n;
+      for (i = 0; i < k; ++i)
+	v[i] = (int32_t) xdr__load32 (r->in_cur + i * BYTES_PER_XDR_UNIT);
+      r->in_cur += k * BYTES_PER_XDR_UNIT;
+      r->frag_left -= k * BYTES_PER_XDR_UNIT;
+    }
+    v += k;
+    n -= k;
+  }
+  return TRUE;
+}
+
+/* Discard the rest of the current record. */
+static bool_t
+skip_record (struct xdrrec *r)
+{
+  while (r->frag_left > 0 || !r->last_frag) {
+    if (!get_input_bytes (r, NULL, r->frag_left))
+      return FALSE;
+    r->frag_left = 0;
+    if (!r->last_frag && !set_input_fragment (r))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+bool_t
+xdrrec_skiprecord (XDR *xdrs)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+
+  if (r == NULL)
+    return FALSE;
+
+  if (!skip_record (r))
+    return FALSE;
+  r->last_frag = FALSE;
+  return TRUE;
+}
+
+/* Returns TRUE if there are no more records after the current one.
+ * Unlike SunRPC this reads more input if none is buffered, so it may
+ * block.
+ */
+bool_t
+xdrrec_eof (XDR *xdrs)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+
+  if (r == NULL)
+    return TRUE;
+
+  if (!skip_record (r))
+    return TRUE;
+  if (r->in_cur == r->in_fill && !fill_input (r))
+    return TRUE;
+  return FALSE;
+}
+
+/*----- Common. -----*/
+
+static off_t
+xdrrec_getpostn (XDR *xdrs ATTRIBUTE_UNUSED)
+{
+  return -1;
+}
+
+static bool_t
+xdrrec_setpostn (XDR *xdrs ATTRIBUTE_UNUSED, off_t pos ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+/* Only succeeds if the bytes are in the buffer and inside the
+ * current fragment.
+ */
+static void *
+xdrrec_inline (XDR *xdrs, size_t len)
+{
+  struct xdrrec *r = XDRREC (xdrs);
+  char *p;
+
+  if (r == NULL)
+    return NULL;
+
+  switch (xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      p = r->out_cur;
+      if ((size_t) (r->out_boundary - p) < len)
+	return NULL;
+      r->out_cur += len;
+      return p;
+    case XDR_DECODE:
+      p = r->in_cur;
+      if (r->frag_left < len || (size_t) (r->in_fill - p) < len)
+	return NULL;
+      r->in_cur += len;
+      r->frag_left -= len;
+      return p;
+    default:
+      return NULL;
+    }
+}
+
+static void
+xdrrec_destroy (XDR *xdrs)
+{
+  free (xdrs->x__private);
+  xdrs->x__private = NULL;
+}
+
+static const struct xdr_ops xdrrec_ops = {
+  xdrrec_getlong,
+  xdrrec_putlong,
+  xdrrec_getbytes,
+  xdrrec_putbytes,
+  xdrrec_getpostn,
+  xdrrec_setpostn,
+  xdrrec_inline,
+  xdrrec_destroy,
+  xdrrec_getlongs,
+  xdrrec_putlongs
+};
+
+void
+xdrrec_create (XDR *xdrs, uint32_t sendsize, uint32_t recvsize,
+	       void *handle,
+	       int (*readit) (void *, void *, int),
+	       int (*writeit) (void *, void *, int))
+{
+  xdrrec_create2 (xdrs, sendsize, recvsize, 0, handle, readit, writeit);
+}
+
+void
+xdrrec_create2 (XDR *xdrs, uint32_t sendsize, uint32_t recvsize,
+		uint32_t fragsize, void *handle,
+		int (*readit) (void *, void *, int),
+		int (*writeit) (void *, void *, int))
+{
+  struct xdrrec *r;
+
+  if (sendsize == 0)
+    sendsize = XDRREC_DEFAULT_BUFSIZE;
+  if (recvsize == 0)
+    recvsize = XDRREC_DEFAULT_BUFSIZE;
+  sendsize = RNDUP (sendsize);
+  recvsize = RNDUP (recvsize);
+  if (sendsize < 2 * BYTES_PER_XDR_UNIT)
+    sendsize = 2 * BYTES_PER_XDR_UNIT;
+  if (recvsize < BYTES_PER_XDR_UNIT)
+    recvsize = BYTES_PER_XDR_UNIT;
+
+  /* By default (and at most) a fragment fills the send buffer. */
+  fragsize &= ~(BYTES_PER_XDR_UNIT - 1);
+  if (fragsize == 0 || fragsize > sendsize - BYTES_PER_XDR_UNIT)
+    fragsize = sendsize - BYTES_PER_XDR_UNIT;
+  if (fragsize > ~LAST_FRAG)
+    fragsize = ~LAST_FRAG & ~(BYTES_PER_XDR_UNIT - 1);
+
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrrec_ops;
+  xdrs->x__flags = 0;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+
+  r = malloc (sizeof *r + sendsize + recvsize);
+  xdrs->x__private = r;
+  if (r == NULL)
+    return;
+
+  r->handle = handle;
+  r->readit = readit;
+  r->writeit = writeit;
+
+  r->out_buf = r->out_cur = r->buf;
+  r->out_end = r->out_buf + sendsize;
+  r->frag_size = fragsize;
+  start_fragment (r);
+
+  r->in_buf = r->in_cur = r->in_fill = r->buf + sendsize;
+  r->in_size = recvsize;
+  r->frag_left = 0;
+  r->last_frag = TRUE;
+}
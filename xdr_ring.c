@@ -0,0 +1,330 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Multi-producer encode rings, created by xdr_ring_create, and the
+ * streams which encode into them, created by xdrring_create.
+ *
+ * Producers reserve a slot by adding its size to the head position
+ * with an atomic fetch-and-add, so they never wait for each other.
+ * A slot is an 8 byte header followed by room for the message:
+ *
+ *   uint32_t size;          whole slot, including the header
+ *   uint32_t committed;     XDRRING_COMMITTED | bytes encoded
+ *
+ * The encode stream is an ordinary memory stream over the slot.
+ * Publishing stores the committed word with release semantics, and
+ * the consumer waits for it (with acquire semantics) before writing
+ * out the slot.  Slots are drained strictly in reservation order.
+ *
+ * A slot never wraps around the end of the ring.  If a reservation
+ * would, it is published empty as padding and the producer reserves
+ * again.  The consumer zeroes everything it drains, so a committed
+ * word can only be non-zero once its slot has been published.
+ *
+ * Positions increase without limit (modulo the size of size_t), and
+ * the offset in the buffer is the position masked by the ring size.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+#define XDRRING_HEADER 8
+#define XDRRING_COMMITTED 0x80000000U
+#define XDRRING_MAX_SIZE ((size_t) 1 << 30)
+#define XDRRING_DRAIN_IOV 64
+
+/* Keep the producers' and the consumer's positions on separate cache
+ * lines, so that draining doesn't slow down reservations.
+ */
+#define CACHE_LINE 64
+
+struct xdr_ring {
+  char *buf;
+  size_t size;			/* power of 2 */
+  char pad0[CACHE_LINE];
+  size_t head;			/* next position to reserve */
+  char pad1[CACHE_LINE];
+  size_t tail;			/* next position to drain */
+  char pad2[CACHE_LINE];
+};
+
+#define XDRRING(xdrs) ((struct xdr_ring *) (xdrs)->x__private)
+
+#ifdef HAVE_ATOMIC_BUILTINS
+
+struct xdr_ring *
+xdr_ring_create (size_t size)
+{
+  struct xdr_ring *r;
+  size_t n;
+
+  if (size > XDRRING_MAX_SIZE) {
+    errno = EINVAL;
+    return NULL;
+  }
+  for (n = 4 * XDRRING_HEADER; n < size; n *= 2)
+    ;
+
+  r = calloc (1, sizeof *r);
+  if (r == NULL)
+    return NULL;
+  r->buf = calloc (1, n);
+  if (r->buf == NULL) {
+    free (r);
+    return NULL;
+  }
+  r->size = n;
+  return r;
+}
+
+void
+xdr_ring_destroy (struct xdr_ring *r)
+{
+  if (r == NULL)
+    return;
+  free (r->buf);
+  free (r);
+}
+
+/* Zero len bytes starting at position pos, which may wrap. */
+static void
+zero (struct xdr_ring *r, size_t pos, size_t len)
+{
+  size_t off = pos & (r->size - 1);
+  size_t n = r->size - off;
+
+  if (n > len)
+    n = len;
+  memset (r->buf + off, 0, n);
+  memset (r->buf, 0, len - n);
+}
+
+ssize_t
+xdr_ring_drain (struct xdr_ring *r, int fd)
+{
+  struct iovec iov[XDRRING_DRAIN_IOV];
+  size_t head, tail, pos, total = 0, len;
+  uint32_t committed;
+  char *hdr;
+  int n;
+
+  tail = __atomic_load_n (&r->tail, __ATOMIC_RELAXED);
+  head = __atomic_load_n (&r->head, __ATOMIC_ACQUIRE);
+
+  while (tail != head) {
+    /* Gather the published slots at the tail.  Producers waiting for
+     * space may have moved head more than a ring's length past tail,
+     * so stop at that point.
+     */
+    n = 0;
+    len = 0;
+    for (pos = tail; pos != head && pos - tail < r->size &&
+	   n < XDRRING_DRAIN_IOV; ) {
+      hdr = r->buf + (pos & (r->size - 1));
+      committed = __atomic_load_n ((uint32_t *) (hdr + 4), __ATOMIC_ACQUIRE);
+      if (!(committed & XDRRING_COMMITTED))
+	break;
+      committed &= ~XDRRING_COMMITTED;
+      if (committed > 0) {
+	iov[n].iov_base = hdr + XDRRING_HEADER;
+	iov[n].iov_len = committed;
+	len += committed;
+	n++;
+      }
+      pos += *(uint32_t *) hdr;
+    }
+    if (pos == tail)
+      break;
+
+    if (!xdr__write_all (fd, iov, n))
+      return -1;
+    total += len;
+
+    zero (r, tail, pos - tail);
+    __atomic_store_n (&r->tail, pos, __ATOMIC_RELEASE);
+    tail = pos;
+  }
+
+  return total;
+}
+
+/* Wait until the consumer has drained enough for the slot ending at
+ * position end to fit.
+ */
+static void
+wait_for_space (struct xdr_ring *r, size_t end)
+{
+  while (end - __atomic_load_n (&r->tail, __ATOMIC_ACQUIRE) > r->size) {
+#ifdef HAVE_SCHED_YIELD
+    sched_yield ();
+#endif
+  }
+}
+
+static void
+commit (XDR *xdrs, uint32_t len)
+{
+  char *hdr = xdrs->x__base - XDRRING_HEADER;
+
+  __atomic_store_n ((uint32_t *) (hdr + 4), XDRRING_COMMITTED | len,
+		    __ATOMIC_RELEASE);
+  xdrs->x__private = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+}
+
+#endif /* HAVE_ATOMIC_BUILTINS */
+
+/* getlong, putlong, getbytes, putbytes and inline are the inline
+ * cursor operations from <rpc/xdr_internal.h>.
+ */
+
+static off_t
+xdrring_getpostn (XDR *xdrs)
+{
+  return xdrs->x__cur - xdrs->x__base;
+}
+
+static bool_t
+xdrring_setpostn (XDR *xdrs, off_t pos)
+{
+  if (pos < 0 || pos > xdrs->x__end - xdrs->x__base)
+    return FALSE;
+  xdrs->x__cur = xdrs->x__base + pos;
+  return TRUE;
+}
+
+/* Destroying a stream which was never published gives up the slot. */
+static void
+xdrring_destroy (XDR *xdrs)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+  if (XDRRING (xdrs))
+    commit (xdrs, 0);
+#endif
+}
+
+static const struct xdr_ops xdrring_ops = {
+  xdrmem_getlong,
+  xdrmem_putlong,
+  xdrmem_getbytes,
+  xdrmem_putbytes,
+  xdrring_getpostn,
+  xdrring_setpostn,
+  xdrmem_inline,
+  xdrring_destroy
+};
+
+bool_t
+xdrring_create (XDR *xdrs, struct xdr_ring *r, size_t maxlen)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+  size_t slot, pos, off;
+  char *hdr;
+#endif
+
+  /* On error, leave behind an empty stream which is safe to use
+   * and destroy.
+   */
+  xdrs->x_op = XDR_ENCODE;
+  xdrs->x_public = NULL;
+  xdrs->x_ops = &xdrring_ops;
+  xdrs->x__private = NULL;
+  xdrs->x__flags = 0;
+  xdrs->x__arena = NULL;
+  xdrs->x__base = xdrs->x__cur = xdrs->x__end = NULL;
+
+#ifdef HAVE_ATOMIC_BUILTINS
+  /* Limiting a slot to half the ring guarantees that a reservation
+   * which follows padding fits before the end.
+   */
+  if (maxlen > r->size / 2 - XDRRING_HEADER) {
+    errno = EMSGSIZE;
+    return FALSE;
+  }
+  slot = XDRRING_HEADER + (maxlen + 7) / 8 * 8;
+
+  for (;;) {
+    pos = __atomic_fetch_add (&r->head, slot, __ATOMIC_RELAXED);
+    wait_for_space (r, pos + slot);
+
+    off = pos & (r->size - 1);
+    hdr = r->buf + off;
+    *(uint32_t *) hdr = slot;
+    xdrs->x__base = hdr + XDRRING_HEADER;
+    if (off + slot <= r->size)
+      break;
+    commit (xdrs, 0);
+  }
+
+  xdrs->x__private = r;
+  xdrs->x__cur = xdrs->x__base;
+  xdrs->x__end = hdr + slot;
+  return TRUE;
+#else
+  errno = ENOSYS;
+  return FALSE;
+#endif
+}
+
+bool_t
+xdrring_publish (XDR *xdrs)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+  if (XDRRING (xdrs) == NULL)
+    return FALSE;
+  commit (xdrs, xdrs->x__cur - xdrs->x__base);
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+#ifndef HAVE_ATOMIC_BUILTINS
+
+struct xdr_ring *
+xdr_ring_create (size_t size ATTRIBUTE_UNUSED)
+{
+  errno = ENOSYS;
+  return NULL;
+}
+
+void
+xdr_ring_destroy (struct xdr_ring *r ATTRIBUTE_UNUSED)
+{
+}
+
+ssize_t
+xdr_ring_drain (struct xdr_ring *r ATTRIBUTE_UNUSED, int fd ATTRIBUTE_UNUSED)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+#endif /* !HAVE_ATOMIC_BUILTINS */
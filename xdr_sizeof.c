@@ -0,0 +1,152 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* xdr_sizeof, which runs an encoder against a counting stream.
+ *
+ * The stream has no cursor, so every put comes through here and
+ * only adds to the count.  No payload is ever read.  xdr_opaque,
+ * xdr_bytes, xdr_string and the bulk array code recognize the
+ * stream and account for their data without calling it at all.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+#define XDRSIZEOF(xdrs) ((struct xdrsizeof *) (xdrs)->x__private)
+
+static bool_t
+xdrsizeof_getlong (XDR *xdrs ATTRIBUTE_UNUSED, int32_t *v ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static bool_t
+xdrsizeof_putlong (XDR *xdrs, int32_t *v ATTRIBUTE_UNUSED)
+{
+  XDRSIZEOF (xdrs)->count += BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+
+static bool_t
+xdrsizeof_putlongs (XDR *xdrs, int32_t *v ATTRIBUTE_UNUSED, size_t n)
+{
+  XDRSIZEOF (xdrs)->count += n * BYTES_PER_XDR_UNIT;
+  return TRUE;
+}
+
+static bool_t
+xdrsizeof_getbytes (XDR *xdrs ATTRIBUTE_UNUSED, void *p ATTRIBUTE_UNUSED,
+		    size_t len ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+static bool_t
+xdrsizeof_putbytes (XDR *xdrs, void *p ATTRIBUTE_UNUSED, size_t len)
+{
+  XDRSIZEOF (xdrs)->count += len;
+  return TRUE;
+}
+
+static off_t
+xdrsizeof_getpostn (XDR *xdrs)
+{
+  return XDRSIZEOF (xdrs)->count;
+}
+
+static bool_t
+xdrsizeof_setpostn (XDR *xdrs ATTRIBUTE_UNUSED, off_t pos ATTRIBUTE_UNUSED)
+{
+  return FALSE;
+}
+
+/* Code which uses xdr_inline expects to write through the pointer,
+ * so hand out a scratch buffer which is reused for each call.  If it
+ * can't be allocated, returning NULL makes the caller fall back to
+ * the ordinary puts, which are counted anyway.
+ */
+static void *
+xdrsizeof_inline (XDR *xdrs, size_t len)
+{
+  struct xdrsizeof *s = XDRSIZEOF (xdrs);
+
+  if (len > s->scratch_size) {
+    void *p = realloc (s->scratch, len);
+    if (p == NULL)
+      return NULL;
+    s->scratch = p;
+    s->scratch_size = len;
+  }
+  s->count += len;
+  return s->scratch;
+}
+
+static void
+xdrsizeof_destroy (XDR *xdrs)
+{
+  struct xdrsizeof *s = XDRSIZEOF (xdrs);
+
+  free (s->scratch);
+  s->scratch = NULL;
+  s->scratch_size = 0;
+}
+
+static const struct xdr_ops xdrsizeof_ops = {
+  xdrsizeof_getlong,
+  xdrsizeof_putlong,
+  xdrsizeof_getbytes,
+  xdrsizeof_putbytes,
+  xdrsizeof_getpostn,
+  xdrsizeof_setpostn,
+  xdrsizeof_inline,
+  xdrsizeof_destroy,
+  NULL,
+  xdrsizeof_putlongs
+};
+
+unsigned long
+xdr_sizeof (xdrproc_t proc, void *p)
+{
+  struct xdrsizeof s;
+  XDR x;
+  bool_t r;
+
+  s.count = 0;
+  s.scratch = NULL;
+  s.scratch_size = 0;
+
+  x.x_op = XDR_ENCODE;
+  x.x_public = NULL;
+  x.x_ops = &xdrsizeof_ops;
+  x.x__private = &s;
+  x.x__flags = XDR__SIZEOF;
+  x.x__arena = NULL;
+  x.x__base = x.x__cur = x.x__end = NULL;
+
+  r = proc (&x, p);
+  xdr_destroy (&x);
+
+  return r ? s.count : 0;
+}
@@ -0,0 +1,224 @@
+/* PortableXDR - a free, portable XDR implementation.
+ * Copyright (C) 2009 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* Bulk byte swapping for arrays of 32 and 64 bit units.
+ *
+ * On x86 we have SSE2 and AVX2 versions and choose between them at
+ * runtime.  Everywhere else the portable loop is written so that the
+ * compiler can turn each iteration into a load, bswap and store.  On
+ * big-endian hosts no swapping is needed at all.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "xdr_private.h"
+
+#if !defined WORDS_BIGENDIAN && defined __GNUC__ && \
+  (defined __x86_64__ || defined __i386__) && \
+  (__GNUC__ >= 5 || defined __clang__)
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#ifdef WORDS_BIGENDIAN
+
+void
+xdr__swap32 (void *dest, const void *src, size_t n)
+{
+  if (dest != src)
+    memcpy (dest, src, n * 4);
+}
+
+void
+xdr__swap64 (void *dest, const void *src, size_t n)
+{
+  if (dest != src)
+    memcpy (dest, src, n * 8);
+}
+
+#else /* !WORDS_BIGENDIAN */
+
+static void
+swap32_generic (void *dest, const void *src, size_t n)
+{
+  char *d = dest;
+  const char *s = src;
+  uint32_t v;
+  size_t i;
+
+  /* Reading big-endian and storing in host order reverses the bytes. */
+  for (i = 0; i < n; ++i) {
+    v = xdr__load32 (s + i * 4);
+    memcpy (d + i * 4, &v, 4);
+  }
+}
+
+static void
+swap64_generic (void *dest, const void *src, size_t n)
+{
+  char *d = dest;
+  const char *s = src;
+  uint64_t v;
+  size_t i;
+
+  for (i = 0; i < n; ++i) {
+    v = (uint64_t) xdr__load32 (s + i * 8) << 32 | xdr__load32 (s + i * 8 + 4);
+    memcpy (d + i * 8, &v, 8);
+  }
+}
+
+#ifdef HAVE_X86_SIMD
+
+/* SSE2 has no byte shuffle, so swap the bytes in each 16 bit word
+ * with shifts, then swap the words with pshuflw/pshufhw.
+ */
+__attribute__ ((target ("sse2"))) static inline __m128i
+swap16_sse2 (__m128i v)
+{
+  return _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+}
+
+__attribute__ ((target ("sse2"))) static void
+swap32_sse2 (void *dest, const void *src, size_t n)
+{
+  char *d = dest;
+  const char *s = src;
+  __m128i v;
+
+  for (; n >= 4; n -= 4, s += 16, d += 16) {
+    v = swap16_sse2 (_mm_loadu_si128 ((const __m128i *) s));
+    v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+    v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+    _mm_storeu_si128 ((__m128i *) d, v);
+  }
+  swap32_generic (d, s, n);
+}
+
+__attribute__ ((target ("sse2"))) static void
+swap64_sse2 (void *dest, const void *src, size_t n)
+{
+  char *d = dest;
+  const char *s = src;
+  __m128i v;
+
+  for (; n >= 2; n -= 2, s += 16, d += 16) {
+    v = swap16_sse2 (_mm_loadu_si128 ((const __m128i *) s));
+    v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+    v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+    _mm_storeu_si128 ((__m128i *) d, v);
+  }
+  swap64_generic (d, s, n);
+}
+
+__attribute__ ((target ("avx2"))) static void
+swap_avx2 (void *dest, const void *src, size_t nbytes, __m256i mask)
+{
+  char *d = dest;
+  const char *s = src;
+  __m256i v0, v1;
+
+  for (; nbytes >= 64; nbytes -= 64, s += 64, d += 64) {
+    v0 = _mm256_loadu_si256 ((const __m256i *) s);
+    v1 = _mm256_loadu_si256 ((const __m256i *) (s + 32));
+    _mm256_storeu_si256 ((__m256i *) d, _mm256_shuffle_epi8 (v0, mask));
+    _mm256_storeu_si256 ((__m256i *) (d + 32), _mm256_shuffle_epi8 (v1, mask));
+  }
+  for (; nbytes >= 32; nbytes -= 32, s += 32, d += 32) {
+    v0 = _mm256_loadu_si256 ((const __m256i *) s);
+    _mm256_storeu_si256 ((__m256i *) d, _mm256_shuffle_epi8 (v0, mask));
+  }
+}
+
+__attribute__ ((target ("avx2"))) static void
+swap32_avx2 (void *dest, const void *src, size_t n)
+{
+  const __m256i mask =
+    _mm256_setr_epi8 (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  size_t done = n & ~(size_t) 7;
+
+  swap_avx2 (dest, src, done * 4, mask);
+  swap32_generic ((char *) dest + done * 4, (const char *) src + done * 4,
+		  n - done);
+}
+
+__attribute__ ((target ("avx2"))) static void
+swap64_avx2 (void *dest, const void *src, size_t n)
+{
+  const __m256i mask =
+    _mm256_setr_epi8 (7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		      7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  size_t done = n & ~(size_t) 3;
+
+  swap_avx2 (dest, src, done * 8, mask);
+  swap64_generic ((char *) dest + done * 8, (const char *) src + done * 8,
+		  n - done);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+typedef void (*swap_fn) (void *, const void *, size_t);
+
+static swap_fn swap32_impl, swap64_impl;
+
+/* Racing threads will all pick the same functions, so no locking
+ * is needed here.
+ */
+static void
+choose_impl (void)
+{
+  swap_fn s32 = swap32_generic, s64 = swap64_generic;
+
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    s32 = swap32_avx2;
+    s64 = swap64_avx2;
+  }
+  else if (__builtin_cpu_supports ("sse2")) {
+    s32 = swap32_sse2;
+    s64 = swap64_sse2;
+  }
+#endif
+
+  swap64_impl = s64;
+  swap32_impl = s32;
+}
+
+void
+xdr__swap32 (void *dest, const void *src, size_t n)
+{
+  if (swap32_impl == NULL)
+    choose_impl ();
+  swap32_impl (dest, src, n);
+}
+
+void
+xdr__swap64 (void *dest, const void *src, size_t n)
+{
+  if (swap64_impl == NULL)
+    choose_impl ();
+  swap64_impl (dest, src, n);
+}
+
+#endif /* !WORDS_BIGENDIAN */